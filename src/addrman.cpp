@@ -129,6 +129,7 @@ void CAddrMan::Delete(int nId)
     SwapRandom(info.nRandomPos, vRandom.size() - 1);
     vRandom.pop_back();
     mapAddr.erase(info);
+    vNewPerNetwork[info.GetNetwork()]--;
     mapInfo.erase(nId);
     nNew--;
 }
@@ -141,24 +142,50 @@ void CAddrMan::ClearNew(int nUBucket, int nUBucketPos)
         CAddrInfo& infoDelete = mapInfo[nIdDelete];
         assert(infoDelete.nRefCount > 0);
         infoDelete.nRefCount--;
-        vvNew[nUBucket][nUBucketPos] = -1;
+        SetNew(nUBucket, nUBucketPos, -1);
         if (infoDelete.nRefCount == 0) {
             Delete(nIdDelete);
         }
     }
 }
 
+/** Set pSlots[nSlot] to nId, adding the slot to or removing it from vOccupied as needed. */
+static void SetSlot(int* pSlots, int* pSlotIndex, std::vector<int>& vOccupied, int nSlot, int nId)
+{
+    if (pSlots[nSlot] == -1 && nId != -1) {
+        pSlotIndex[nSlot] = vOccupied.size();
+        vOccupied.push_back(nSlot);
+    } else if (pSlots[nSlot] != -1 && nId == -1) {
+        int nLast = vOccupied.back();
+        vOccupied[pSlotIndex[nSlot]] = nLast;
+        pSlotIndex[nLast] = pSlotIndex[nSlot];
+        vOccupied.pop_back();
+    }
+    pSlots[nSlot] = nId;
+}
+
+void CAddrMan::SetTried(int nKBucket, int nKBucketPos, int nId)
+{
+    SetSlot(&vvTried[0][0], &vvTriedSlotIndex[0][0], vTriedSlots, nKBucket * ADDRMAN_BUCKET_SIZE + nKBucketPos, nId);
+}
+
+void CAddrMan::SetNew(int nUBucket, int nUBucketPos, int nId)
+{
+    SetSlot(&vvNew[0][0], &vvNewSlotIndex[0][0], vNewSlots, nUBucket * ADDRMAN_BUCKET_SIZE + nUBucketPos, nId);
+}
+
 void CAddrMan::MakeTried(CAddrInfo& info, int nId)
 {
     // remove the entry from all new buckets
     for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
         int pos = info.GetBucketPosition(nKey, true, bucket);
         if (vvNew[bucket][pos] == nId) {
-            vvNew[bucket][pos] = -1;
+            SetNew(bucket, pos, -1);
             info.nRefCount--;
         }
     }
     nNew--;
+    vNewPerNetwork[info.GetNetwork()]--;
 
     assert(info.nRefCount == 0);
 
@@ -175,8 +202,9 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
 
         // Remove the to-be-evicted item from the tried set.
         infoOld.fInTried = false;
-        vvTried[nKBucket][nKBucketPos] = -1;
+        SetTried(nKBucket, nKBucketPos, -1);
         nTried--;
+        vTriedPerNetwork[infoOld.GetNetwork()]--;
 
         // find which new bucket it belongs to
         int nUBucket = infoOld.GetNewBucket(nKey);
@@ -186,13 +214,15 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
 
         // Enter it into the new set again.
         infoOld.nRefCount = 1;
-        vvNew[nUBucket][nUBucketPos] = nIdEvict;
+        SetNew(nUBucket, nUBucketPos, nIdEvict);
         nNew++;
+        vNewPerNetwork[infoOld.GetNetwork()]++;
     }
     assert(vvTried[nKBucket][nKBucketPos] == -1);
 
-    vvTried[nKBucket][nKBucketPos] = nId;
+    SetTried(nKBucket, nKBucketPos, nId);
     nTried++;
+    vTriedPerNetwork[info.GetNetwork()]++;
     info.fInTried = true;
 }
 
@@ -306,6 +336,7 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         pinfo = Create(addr, source, &nId);
         pinfo->nTime = std::max((int64_t)0, (int64_t)pinfo->nTime - nTimePenalty);
         nNew++;
+        vNewPerNetwork[pinfo->GetNetwork()]++;
         fNew = true;
     }
 
@@ -323,7 +354,7 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         if (fInsert) {
             ClearNew(nUBucket, nUBucketPos);
             pinfo->nRefCount++;
-            vvNew[nUBucket][nUBucketPos] = nId;
+            SetNew(nUBucket, nUBucketPos, nId);
         } else {
             if (pinfo->nRefCount == 0) {
                 Delete(nId);
@@ -364,40 +395,18 @@ CAddrInfo CAddrMan::Select_(bool newOnly)
         return CAddrInfo();
 
     // Use a 50% chance for choosing between tried and new table entries.
-    if (!newOnly && (nTried > 0 && (nNew == 0 || RandomInt(2) == 0))) {
-        // use a tried node
-        double fChanceFactor = 1.0;
-        while (1) {
-            int nKBucket = RandomInt(ADDRMAN_TRIED_BUCKET_COUNT);
-            int nKBucketPos = RandomInt(ADDRMAN_BUCKET_SIZE);
-            while (vvTried[nKBucket][nKBucketPos] == -1) {
-                nKBucket = (nKBucket + insecure_rand.randbits(ADDRMAN_TRIED_BUCKET_COUNT_LOG2)) % ADDRMAN_TRIED_BUCKET_COUNT;
-                nKBucketPos = (nKBucketPos + insecure_rand.randbits(ADDRMAN_BUCKET_SIZE_LOG2)) % ADDRMAN_BUCKET_SIZE;
-            }
-            int nId = vvTried[nKBucket][nKBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
-            if (RandomInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
-                return info;
-            fChanceFactor *= 1.2;
-        }
-    } else {
-        // use a new node
-        double fChanceFactor = 1.0;
-        while (1) {
-            int nUBucket = RandomInt(ADDRMAN_NEW_BUCKET_COUNT);
-            int nUBucketPos = RandomInt(ADDRMAN_BUCKET_SIZE);
-            while (vvNew[nUBucket][nUBucketPos] == -1) {
-                nUBucket = (nUBucket + insecure_rand.randbits(ADDRMAN_NEW_BUCKET_COUNT_LOG2)) % ADDRMAN_NEW_BUCKET_COUNT;
-                nUBucketPos = (nUBucketPos + insecure_rand.randbits(ADDRMAN_BUCKET_SIZE_LOG2)) % ADDRMAN_BUCKET_SIZE;
-            }
-            int nId = vvNew[nUBucket][nUBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
-            if (RandomInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
-                return info;
-            fChanceFactor *= 1.2;
-        }
+    // Positions are drawn from the lists of occupied ones, so the cost does
+    // not depend on how sparsely the buckets are filled.
+    const std::vector<int>& vSlots = (!newOnly && (nTried > 0 && (nNew == 0 || RandomInt(2) == 0))) ? vTriedSlots : vNewSlots;
+    const int* pSlots = (&vSlots == &vTriedSlots) ? &vvTried[0][0] : &vvNew[0][0];
+    double fChanceFactor = 1.0;
+    while (1) {
+        int nId = pSlots[vSlots[RandomInt(vSlots.size())]];
+        assert(mapInfo.count(nId) == 1);
+        CAddrInfo& info = mapInfo[nId];
+        if (RandomInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
+            return info;
+        fChanceFactor *= 1.2;
     }
 }
 
@@ -450,6 +459,8 @@ int CAddrMan::Check_()
                     return -17;
                 if (mapInfo[vvTried[n][i]].GetBucketPosition(nKey, false, n) != i)
                     return -18;
+                if (vTriedSlots[vvTriedSlotIndex[n][i]] != n * ADDRMAN_BUCKET_SIZE + i)
+                    return -20;
                 setTried.erase(vvTried[n][i]);
             }
         }
@@ -462,6 +473,8 @@ int CAddrMan::Check_()
                     return -12;
                 if (mapInfo[vvNew[n][i]].GetBucketPosition(nKey, true, n) != i)
                     return -19;
+                if (vNewSlots[vvNewSlotIndex[n][i]] != n * ADDRMAN_BUCKET_SIZE + i)
+                    return -21;
                 if (--mapNew[vvNew[n][i]] == 0)
                     mapNew.erase(vvNew[n][i]);
             }
@@ -215,6 +215,21 @@ private:
     //! list of "new" buckets
     int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
 
+    //! occupied positions of vvTried and vvNew (as bucket * ADDRMAN_BUCKET_SIZE + position), in no particular order
+    std::vector<int> vTriedSlots;
+    std::vector<int> vNewSlots;
+
+    //! index of each occupied position in vTriedSlots and vNewSlots (only meaningful for occupied positions)
+    int vvTriedSlotIndex[ADDRMAN_TRIED_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
+    int vvNewSlotIndex[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
+
+    //! number of "tried" and (unique) "new" entries per network
+    int vTriedPerNetwork[NET_MAX];
+    int vNewPerNetwork[NET_MAX];
+
+    //! number of modifications since creation, used to skip unneeded dumps (memory only)
+    uint64_t nModifications;
+
     //! last time Good was called (memory only)
     int64_t nLastGood;
 
@@ -247,6 +262,10 @@ protected:
     //! Clear a position in a "new" table. This is the only place where entries are actually deleted.
     void ClearNew(int nUBucket, int nUBucketPos);
 
+    //! Set a position in the "tried" or "new" table, keeping the lists of occupied positions up to date.
+    void SetTried(int nKBucket, int nKBucketPos, int nId);
+    void SetNew(int nUBucket, int nUBucketPos, int nId);
+
     //! Mark an entry "good", possibly moving it from "new" to "tried".
     void Good_(const CService& addr, bool test_before_evict, int64_t time);
 
@@ -396,10 +415,11 @@ public:
                 int nUBucket = info.GetNewBucket(nKey);
                 int nUBucketPos = info.GetBucketPosition(nKey, true, nUBucket);
                 if (vvNew[nUBucket][nUBucketPos] == -1) {
-                    vvNew[nUBucket][nUBucketPos] = n;
+                    SetNew(nUBucket, nUBucketPos, n);
                     info.nRefCount++;
                 }
             }
+            vNewPerNetwork[info.GetNetwork()]++;
         }
         nIdCount = nNew;
 
@@ -416,7 +436,8 @@ public:
                 vRandom.push_back(nIdCount);
                 mapInfo[nIdCount] = info;
                 mapAddr[info] = nIdCount;
-                vvTried[nKBucket][nKBucketPos] = nIdCount;
+                SetTried(nKBucket, nKBucketPos, nIdCount);
+                vTriedPerNetwork[info.GetNetwork()]++;
                 nIdCount++;
             } else {
                 nLost++;
@@ -436,7 +457,7 @@ public:
                     int nUBucketPos = info.GetBucketPosition(nKey, true, bucket);
                     if (nVersion == 1 && nUBuckets == ADDRMAN_NEW_BUCKET_COUNT && vvNew[bucket][nUBucketPos] == -1 && info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS) {
                         info.nRefCount++;
-                        vvNew[bucket][nUBucketPos] = nIndex;
+                        SetNew(bucket, nUBucketPos, nIndex);
                     }
                 }
             }
@@ -476,10 +497,21 @@ public:
             }
         }
 
+        mapInfo.clear();
+        mapAddr.clear();
+        m_tried_collisions.clear();
+        vTriedSlots.clear();
+        vNewSlots.clear();
+        for (int net = 0; net < NET_MAX; net++) {
+            vTriedPerNetwork[net] = 0;
+            vNewPerNetwork[net] = 0;
+        }
+
         nIdCount = 0;
         nTried = 0;
         nNew = 0;
         nLastGood = 1; //Initially at 1 so that "never" is strictly worse.
+        nModifications = 0;
     }
 
     CAddrMan()
@@ -499,6 +531,21 @@ public:
         return vRandom.size();
     }
 
+    //! Return the number of (unique) addresses of a network in the tried or new table.
+    size_t size(enum Network net, bool fTried) const
+    {
+        assert(net >= 0 && net < NET_MAX);
+        LOCK(cs);
+        return fTried ? vTriedPerNetwork[net] : vNewPerNetwork[net];
+    }
+
+    //! Return a counter that changes whenever the content to be serialized may have changed.
+    uint64_t GetModifications() const
+    {
+        LOCK(cs);
+        return nModifications;
+    }
+
     //! Consistency check
     void Check()
     {
@@ -519,6 +566,7 @@ public:
         bool fRet = false;
         Check();
         fRet |= Add_(addr, source, nTimePenalty);
+        nModifications++;
         Check();
         if (fRet)
             LogPrint(BCLog::ADDRMAN, "Added %s from %s: %i tried, %i new\n", addr.ToStringIPPort(), source.ToString(), nTried, nNew);
@@ -533,6 +581,7 @@ public:
         Check();
         for (std::vector<CAddress>::const_iterator it = vAddr.begin(); it != vAddr.end(); it++)
             nAdd += Add_(*it, source, nTimePenalty) ? 1 : 0;
+        nModifications++;
         Check();
         if (nAdd)
             LogPrint(BCLog::ADDRMAN, "Added %i addresses from %s: %i tried, %i new\n", nAdd, source.ToString(), nTried, nNew);
@@ -545,6 +594,7 @@ public:
         LOCK(cs);
         Check();
         Good_(addr, test_before_evict, nTime);
+        nModifications++;
         Check();
     }
 
@@ -554,6 +604,7 @@ public:
         LOCK(cs);
         Check();
         Attempt_(addr, fCountFailure, nTime);
+        nModifications++;
         Check();
     }
 
@@ -562,7 +613,10 @@ public:
     {
         LOCK(cs);
         Check();
-        ResolveCollisions_();
+        if (!m_tried_collisions.empty()) {
+            ResolveCollisions_();
+            nModifications++;
+        }
         Check();
     }
 
@@ -614,6 +668,7 @@ public:
         LOCK(cs);
         Check();
         Connected_(addr, nTime);
+        nModifications++;
         Check();
     }
 
@@ -622,6 +677,7 @@ public:
         LOCK(cs);
         Check();
         SetServices_(addr, nServices);
+        nModifications++;
         Check();
     }
 };
@@ -0,0 +1,115 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockprevalidation.h"
+
+#include "blocksignature.h"
+#include "consensus/merkle.h"
+#include "main.h"
+#include "util.h"
+
+#include <algorithm>
+
+#include <boost/thread.hpp>
+
+CBlockPreValidator blockPreValidator;
+
+void CBlockPreValidator::AddResult(const ResultKey& key, const CBlockPreValidationResult& result)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (mapResults.emplace(key, result).second)
+        vResultOrder.push_back(key);
+    while (vResultOrder.size() > MAX_BLOCK_PREVALIDATION_RESULTS) {
+        mapResults.erase(vResultOrder.front());
+        vResultOrder.pop_front();
+    }
+}
+
+void CBlockPreValidator::Submit(const CDataStream& vRecv, int nRecvVersion)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (nWorkers == 0 || queue.size() >= MAX_BLOCK_PREVALIDATION_QUEUE)
+        return;
+    queue.push_back(vRecv);
+    queue.back().SetVersion(nRecvVersion);
+    condWorker.notify_one();
+}
+
+bool CBlockPreValidator::GetResult(const uint256& hash, const std::vector<unsigned char>& vchBlockSig, CBlockPreValidationResult& result)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    auto it = mapResults.find(std::make_pair(hash, vchBlockSig));
+    if (it == mapResults.end())
+        return false;
+    result = it->second;
+    // a stale key would count against the limit, and evict a later result for the same key
+    vResultOrder.erase(std::find(vResultOrder.begin(), vResultOrder.end(), it->first));
+    mapResults.erase(it);
+    return true;
+}
+
+void CBlockPreValidator::Thread()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nWorkers++;
+    }
+    try {
+        while (true) {
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty())
+                    condWorker.wait(lock);
+                ssBlock = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            CBlock block;
+            try {
+                ssBlock >> block;
+            } catch (const std::exception& e) {
+                // malformed messages are reported by ProcessMessages
+                continue;
+            }
+            if (!block.IsProofOfStake() || block.vtx.size() < 2)
+                continue;
+
+            // Only keep results whose transactions are committed to by the header,
+            // so the block hash is enough to match them with the processed block.
+            bool mutated;
+            if (BlockMerkleRoot(block, &mutated) != block.hashMerkleRoot || mutated)
+                continue;
+
+            CBlockPreValidationResult result;
+            result.fEnableP2PKH = Params().GetConsensus().NetworkUpgradeActive(GetChainHeight() + 1, Consensus::UPGRADE_V5_DUMMY);
+            result.fSigValid = CheckBlockSignature(block, result.fEnableP2PKH);
+            AddResult(std::make_pair(block.GetHash(), block.vchBlockSig), result);
+        }
+    } catch (const boost::thread_interrupted&) {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nWorkers--;
+        throw;
+    }
+}
+
+bool CBlockPreValidator::IsEnabled()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nWorkers > 0;
+}
+
+void CBlockPreValidator::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    queue.clear();
+    mapResults.clear();
+    vResultOrder.clear();
+}
+
+void ThreadBlockPreValidation()
+{
+    util::ThreadRename("rpdchain-blkprev");
+    blockPreValidator.Thread();
+}
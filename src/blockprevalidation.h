@@ -0,0 +1,85 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPDCHAIN_BLOCKPREVALIDATION_H
+#define RPDCHAIN_BLOCKPREVALIDATION_H
+
+#include "streams.h"
+#include "uint256.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** Default for -blockprevalidationthreads, number of context-free block check workers (0 = disabled) */
+static const int DEFAULT_BLOCK_PREVALIDATION_THREADS = 2;
+/** Maximum number of context-free block check workers */
+static const int MAX_BLOCK_PREVALIDATION_THREADS = 8;
+/** Maximum number of queued block messages waiting for a worker */
+static const size_t MAX_BLOCK_PREVALIDATION_QUEUE = 64;
+/** Maximum number of pre-validation results kept until their block is processed */
+static const size_t MAX_BLOCK_PREVALIDATION_RESULTS = 256;
+
+/**
+ * Outcome of the context-free checks run ahead of ProcessNewBlock. Results
+ * are only stored for blocks whose merkle root matched, so once the caller's
+ * own CheckBlock passes, the block hash identifies the same transactions.
+ * The hash does not commit to the block signature, so results are keyed by
+ * both: copies of a block with different signatures never share a verdict.
+ */
+struct CBlockPreValidationResult {
+    //! the enableP2PKH flag the block signature was checked with
+    bool fEnableP2PKH{false};
+    //! result of CheckBlockSignature
+    bool fSigValid{false};
+};
+
+/**
+ * Runs the expensive, context-free part of block validation (the block
+ * signature) on a pool of worker threads as soon as block messages
+ * are queued for a peer. ProcessNewBlock picks the results up later on the
+ * message handler thread, so the next blocks of a batch are checked while
+ * the current one is still being connected.
+ */
+class CBlockPreValidator
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+
+    //! serialized block messages waiting for a worker
+    std::deque<CDataStream> queue;
+
+    typedef std::pair<uint256, std::vector<unsigned char> > ResultKey;
+
+    //! finished results by block hash and signature, and their insertion order for eviction
+    std::map<ResultKey, CBlockPreValidationResult> mapResults;
+    std::deque<ResultKey> vResultOrder;
+
+    int nWorkers{0};
+
+    void AddResult(const ResultKey& key, const CBlockPreValidationResult& result);
+
+public:
+    /** Copy a serialized "block" payload and queue it for pre-validation. */
+    void Submit(const CDataStream& vRecv, int nRecvVersion);
+
+    /** Take the result for the given block and signature, if a worker already produced one. */
+    bool GetResult(const uint256& hash, const std::vector<unsigned char>& vchBlockSig, CBlockPreValidationResult& result);
+
+    /** Worker loop, run by each pre-validation thread until interrupted. */
+    void Thread();
+
+    bool IsEnabled();
+    void Clear();
+};
+
+extern CBlockPreValidator blockPreValidator;
+
+void ThreadBlockPreValidation();
+
+#endif // RPDCHAIN_BLOCKPREVALIDATION_H
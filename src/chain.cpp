@@ -176,10 +176,8 @@ bool CBlockIndex::SetStakeEntropyBit(unsigned int nEntropyBit)
 // Sets V1 stake modifier (uint64_t)
 void CBlockIndex::SetStakeModifier(const uint64_t nStakeModifier, bool fGeneratedStakeModifier)
 {
-    vStakeModifier.clear();
-    const size_t modSize = sizeof(nStakeModifier);
-    vStakeModifier.resize(modSize);
-    std::memcpy(vStakeModifier.data(), &nStakeModifier, modSize);
+    const unsigned char* pbegin = (const unsigned char*)&nStakeModifier;
+    vStakeModifier.assign(pbegin, pbegin + sizeof(nStakeModifier));
     if (fGeneratedStakeModifier)
         nFlags |= BLOCK_STAKE_MODIFIER;
 
@@ -201,8 +199,7 @@ void CBlockIndex::SetNewStakeModifier()
 // Sets V2 stake modifiers (uint256)
 void CBlockIndex::SetStakeModifier(const uint256& nStakeModifier)
 {
-    vStakeModifier.clear();
-    vStakeModifier.insert(vStakeModifier.begin(), nStakeModifier.begin(), nStakeModifier.end());
+    vStakeModifier.assign(nStakeModifier.begin(), nStakeModifier.end());
 }
 
 // Generates and sets new V2 stake modifier
@@ -224,8 +221,8 @@ uint64_t CBlockIndex::GetStakeModifierV1() const
 {
     if (vStakeModifier.empty() || Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
         return 0;
-    uint64_t nStakeModifier;
-    std::memcpy(&nStakeModifier, vStakeModifier.data(), vStakeModifier.size());
+    uint64_t nStakeModifier = 0;
+    std::memcpy(&nStakeModifier, vStakeModifier.data(), std::min(vStakeModifier.size(), sizeof(nStakeModifier)));
     return nStakeModifier;
 }
 
@@ -235,7 +232,7 @@ uint256 CBlockIndex::GetStakeModifierV2() const
     if (vStakeModifier.empty() || !Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
         return UINT256_ZERO;
     uint256 nStakeModifier;
-    std::memcpy(nStakeModifier.begin(), vStakeModifier.data(), vStakeModifier.size());
+    std::memcpy(nStakeModifier.begin(), vStakeModifier.data(), std::min(vStakeModifier.size(), (size_t)nStakeModifier.size()));
     return nStakeModifier;
 }
 
@@ -19,6 +19,8 @@
 #include "util.h"
 #include "libzerocoin/Denominations.h"
 
+#include <cassert>
+#include <cstring>
 #include <vector>
 
 class CBlockFileInfo
@@ -167,6 +169,59 @@ enum {
     BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
 };
 
+/**
+ * Stake modifier bytes kept inline in the block index instead of in a heap
+ * allocated vector: empty for PoW blocks, 8 bytes for modifier V1 and 32
+ * bytes for modifier V2. Serialized exactly like a std::vector<unsigned char>.
+ */
+class CStakeModifierBytes
+{
+public:
+    static const size_t MAX_SIZE = 32;
+
+private:
+    uint8_t nSize{0};
+    unsigned char vch[MAX_SIZE]{};
+
+public:
+    bool empty() const { return nSize == 0; }
+    size_t size() const { return nSize; }
+    const unsigned char* data() const { return vch; }
+    void clear() { nSize = 0; }
+
+    void assign(const unsigned char* pbegin, const unsigned char* pend)
+    {
+        const size_t nNewSize = pend - pbegin;
+        assert(nNewSize <= MAX_SIZE);
+        std::memcpy(vch, pbegin, nNewSize);
+        nSize = (uint8_t)nNewSize;
+    }
+
+    friend bool operator==(const CStakeModifierBytes& a, const CStakeModifierBytes& b)
+    {
+        return a.nSize == b.nSize && std::memcmp(a.vch, b.vch, a.nSize) == 0;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, nSize);
+        if (nSize)
+            s.write((const char*)vch, nSize);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint64_t nNewSize = ReadCompactSize(s);
+        if (nNewSize > MAX_SIZE)
+            throw std::ios_base::failure("stake modifier size too large");
+        if (nNewSize)
+            s.read((char*)vch, nNewSize);
+        nSize = (uint8_t)nNewSize;
+    }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -212,9 +267,9 @@ public:
     unsigned int nStatus{0};
 
     // proof-of-stake specific fields
-    // char vector holding the stake modifier bytes. It is empty for PoW blocks.
+    // bytes of the stake modifier. It is empty for PoW blocks.
     // Modifier V1 is 64 bit while modifier V2 is 256 bit.
-    std::vector<unsigned char> vStakeModifier{};
+    CStakeModifierBytes vStakeModifier{};
     unsigned int nFlags{0};
 
     //! block header
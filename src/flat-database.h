@@ -0,0 +1,215 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPDCHAIN_FLAT_DATABASE_H
+#define RPDCHAIN_FLAT_DATABASE_H
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "fs.h"
+#include "hash.h"
+#include "streams.h"
+#include "sync.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <string>
+
+/**
+ * Flat file cache of a manager (masternodes, budgets, payments).
+ *
+ * The file holds the magic message of the cache, the network magic number,
+ * the serialized manager and the hash of everything before it. T must be
+ * serializable (taking its own locks), and provide Clear() and ToString().
+ */
+template <typename T>
+class CFlatDB
+{
+private:
+    fs::path pathDB;
+    std::string strFilename;
+    std::string strMagicMessage;
+    BCLog::LogFlags logCategory;
+
+    // the masternode thread and Shutdown both dump, through the same temporary file
+    static RecursiveMutex cs_dump;
+
+public:
+    enum ReadResult {
+        Ok,
+        FileError,
+        HashReadError,
+        IncorrectHash,
+        IncorrectMagicMessage,
+        IncorrectMagicNumber,
+        IncorrectFormat
+    };
+
+    CFlatDB(const std::string& strFilenameIn, const std::string& strMagicMessageIn, BCLog::LogFlags logCategoryIn) :
+        pathDB(GetDataDir() / strFilenameIn),
+        strFilename(strFilenameIn),
+        strMagicMessage(strMagicMessageIn),
+        logCategory(logCategoryIn)
+    {}
+
+    bool Write(const T& objToSave)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        // serialize, checksum data up to that point, then append checksum
+        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+        ssObj << strMagicMessage;                   // cache file specific magic message
+        ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
+        ssObj << objToSave;
+        uint256 hash = Hash(ssObj.begin(), ssObj.end());
+        ssObj << hash;
+
+        // write to a temporary file moved over the old one once it is on disk, so a crash leaves a whole cache behind
+        fs::path pathTmp = pathDB;
+        pathTmp += ".new";
+        FILE* file = fsbridge::fopen(pathTmp, "wb");
+        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+        if (fileout.IsNull())
+            return error("%s : Failed to open file %s", __func__, pathTmp.string());
+
+        // Write and commit header, data
+        try {
+            fileout << ssObj;
+        } catch (const std::exception& e) {
+            return error("%s : Serialize or I/O error - %s", __func__, e.what());
+        }
+        FileCommit(fileout.Get());
+        fileout.fclose();
+
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s : Rename-into-place failed", __func__);
+
+        LogPrint(logCategory, "Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrint(logCategory, "  %s\n", objToSave.ToString());
+
+        return true;
+    }
+
+    ReadResult Read(T& objToLoad)
+    {
+        int64_t nStart = GetTimeMillis();
+        // open input file, and associate with CAutoFile
+        FILE* file = fsbridge::fopen(pathDB, "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            error("%s : Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
+
+        // the data is deserialized straight from the file and hashed on the way
+        CHashVerifier<CAutoFile> verifier(&filein);
+        try {
+            ReadResult result = ReadHeader(verifier);
+            if (result != Ok)
+                return result;
+
+            verifier >> objToLoad;
+        } catch (const std::exception& e) {
+            objToLoad.Clear();
+            error("%s : Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+
+        // verify stored checksum matches input data
+        uint256 hashIn;
+        try {
+            filein >> hashIn;
+        } catch (const std::exception& e) {
+            objToLoad.Clear();
+            error("%s : Deserialize or I/O error - %s", __func__, e.what());
+            return HashReadError;
+        }
+        if (hashIn != verifier.GetHash()) {
+            objToLoad.Clear();
+            error("%s : Checksum mismatch, data corrupted", __func__);
+            return IncorrectHash;
+        }
+
+        LogPrint(logCategory, "Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrint(logCategory, "  %s\n", objToLoad.ToString());
+
+        return Ok;
+    }
+
+    /// Check that the file is a cache of ours (magic message and network) without loading it
+    ReadResult CheckHeader()
+    {
+        FILE* file = fsbridge::fopen(pathDB, "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return FileError;
+
+        try {
+            CHashVerifier<CAutoFile> verifier(&filein);
+            return ReadHeader(verifier);
+        } catch (const std::exception& e) {
+            error("%s : Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+    }
+
+    /// Write the cache, unless the file there is not one of ours
+    void Dump(const T& objToSave)
+    {
+        LOCK(cs_dump);
+
+        int64_t nStart = GetTimeMillis();
+
+        LogPrint(logCategory, "Verifying %s header...\n", strFilename);
+        ReadResult readResult = CheckHeader();
+        // there was an error and it was not an error on file opening => do not proceed
+        if (readResult == FileError)
+            LogPrint(logCategory, "Missing cache file - %s, will try to recreate\n", strFilename);
+        else if (readResult != Ok) {
+            LogPrint(logCategory, "Error reading %s: ", strFilename);
+            if (readResult == IncorrectFormat)
+                LogPrint(logCategory, "magic is ok but data has invalid format, will try to recreate\n");
+            else {
+                LogPrint(logCategory, "file format is unknown or invalid, please fix it manually\n");
+                return;
+            }
+        }
+        LogPrint(logCategory, "Writting info to %s...\n", strFilename);
+        Write(objToSave);
+
+        LogPrint(logCategory, "Dump of %s finished  %dms\n", strFilename, GetTimeMillis() - nStart);
+    }
+
+private:
+    ReadResult ReadHeader(CHashVerifier<CAutoFile>& verifier)
+    {
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
+
+        // de-serialize file header (cache file specific magic message) and ..
+        verifier >> strMagicMessageTmp;
+
+        // ... verify the message matches predefined one
+        if (strMagicMessage != strMagicMessageTmp) {
+            error("%s : Invalid %s magic message", __func__, strFilename);
+            return IncorrectMagicMessage;
+        }
+
+        // de-serialize file header (network specific magic number) and ..
+        verifier >> FLATDATA(pchMsgTmp);
+
+        // ... verify the network matches ours
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
+            error("%s : Invalid network magic number", __func__);
+            return IncorrectMagicNumber;
+        }
+
+        return Ok;
+    }
+};
+
+template <typename T>
+RecursiveMutex CFlatDB<T>::cs_dump;
+
+#endif // RPDCHAIN_FLAT_DATABASE_H
@@ -0,0 +1,106 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "headerchaincache.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "version.h"
+
+#include <algorithm>
+
+CHeaderChainCache headerChainCache;
+
+void CHeaderChainCache::Truncate(int nHeight)
+{
+    for (int h = nHeight; h < (int)vHashes.size(); h++)
+        mapHeights.erase(vHashes[h]);
+    vHashes.resize(nHeight);
+    vData.resize(vOffsets[nHeight]);
+    vOffsets.resize(nHeight + 1);
+}
+
+void CHeaderChainCache::SetTip(const CBlockIndex* pindexTip)
+{
+    LOCK(cs);
+    if (!pindexTip) {
+        Truncate(0);
+        return;
+    }
+
+    // Drop what follows the last block shared with the new chain.
+    int nFork = std::min((int)vHashes.size() - 1, pindexTip->nHeight);
+    const CBlockIndex* pindexFork = nFork >= 0 ? pindexTip->GetAncestor(nFork) : nullptr;
+    while (pindexFork && vHashes[nFork] != pindexFork->GetBlockHash()) {
+        pindexFork = pindexFork->pprev;
+        nFork--;
+    }
+    Truncate(nFork + 1);
+
+    std::vector<const CBlockIndex*> vConnect;
+    for (const CBlockIndex* pindex = pindexTip; pindex && pindex->nHeight > nFork; pindex = pindex->pprev)
+        vConnect.push_back(pindex);
+    vHashes.reserve(pindexTip->nHeight + 1);
+    vOffsets.reserve(pindexTip->nHeight + 2);
+    for (auto it = vConnect.rbegin(); it != vConnect.rend(); ++it) {
+        const CBlockIndex* pindex = *it;
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, vData, vData.size(), pindex->GetBlockHeader(), std::vector<CTransaction>());
+        mapHeights.emplace(pindex->GetBlockHash(), vHashes.size());
+        vHashes.push_back(pindex->GetBlockHash());
+        vOffsets.push_back(vData.size());
+    }
+}
+
+int CHeaderChainCache::Height() const
+{
+    LOCK(cs);
+    return (int)vHashes.size() - 1;
+}
+
+int CHeaderChainCache::GetHeight(const uint256& hash) const
+{
+    LOCK(cs);
+    auto it = mapHeights.find(hash);
+    return it == mapHeights.end() ? -1 : it->second;
+}
+
+int CHeaderChainCache::FindFork(const CBlockLocator& locator) const
+{
+    LOCK(cs);
+    for (const uint256& hash : locator.vHave) {
+        auto it = mapHeights.find(hash);
+        if (it != mapHeights.end())
+            return it->second;
+    }
+    return vHashes.empty() ? -1 : 0;
+}
+
+std::vector<uint256> CHeaderChainCache::GetHashes(int nStart, int nCount) const
+{
+    LOCK(cs);
+    if (nStart < 0 || nStart >= (int)vHashes.size() || nCount <= 0)
+        return std::vector<uint256>();
+    int nEnd = std::min((int)vHashes.size(), nStart + nCount);
+    return std::vector<uint256>(vHashes.begin() + nStart, vHashes.begin() + nEnd);
+}
+
+int CHeaderChainCache::GetHeaders(int nStart, int nLimit, const uint256& hashStop, std::vector<unsigned char>& vPayload) const
+{
+    LOCK(cs);
+    int nEnd = nStart;
+    if (nStart >= 0) {
+        while (nEnd < (int)vHashes.size() && nEnd - nStart < nLimit) {
+            if (vHashes[nEnd++] == hashStop)
+                break;
+        }
+    }
+    int nCount = nEnd - nStart;
+
+    vPayload.clear();
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, vPayload, 0, COMPACTSIZE((uint64_t)nCount));
+    if (nCount > 0)
+        vPayload.insert(vPayload.end(), vData.begin() + vOffsets[nStart], vData.begin() + vOffsets[nEnd]);
+    return nCount;
+}
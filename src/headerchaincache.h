@@ -0,0 +1,62 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPDCHAIN_HEADERCHAINCACHE_H
+#define RPDCHAIN_HEADERCHAINCACHE_H
+
+#include "main.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Copy of the active chain's block hashes and serialized headers, indexed by
+ * height, so getblocks and getheaders requests are answered without cs_main.
+ *
+ * Headers are stored back to back, each followed by an empty transaction
+ * vector, which is how a headers message encodes them: a response is the
+ * count followed by one contiguous slice of the buffer. The cache follows
+ * chainActive through SetTip, which only touches the blocks past the fork.
+ */
+class CHeaderChainCache
+{
+private:
+    mutable RecursiveMutex cs;
+    std::vector<uint256> vHashes;
+    //! vOffsets[h] is where the header at height h starts in vData, with a final entry for the end
+    std::vector<uint32_t> vOffsets{0};
+    std::vector<unsigned char> vData;
+    std::unordered_map<uint256, int, BlockHasher> mapHeights;
+
+    void Truncate(int nHeight);
+
+public:
+    //! Follow chainActive to its new tip (nullptr to clear).
+    void SetTip(const CBlockIndex* pindexTip);
+
+    //! Height of the tip, -1 when empty.
+    int Height() const;
+
+    //! Height of a block of the cached chain, -1 if it is not on it.
+    int GetHeight(const uint256& hash) const;
+
+    //! Height of the first locator entry found on the cached chain, else 0 (genesis), -1 when empty. See FindForkInGlobalIndex.
+    int FindFork(const CBlockLocator& locator) const;
+
+    //! Hashes of at most nCount blocks from height nStart on.
+    std::vector<uint256> GetHashes(int nStart, int nCount) const;
+
+    /**
+     * Serialize a headers message payload with the headers from height nStart
+     * on, stopping after nLimit headers or after hashStop. Returns the number
+     * of headers it holds.
+     */
+    int GetHeaders(int nStart, int nLimit, const uint256& hashStop, std::vector<unsigned char>& vPayload) const;
+};
+
+extern CHeaderChainCache headerChainCache;
+
+#endif // RPDCHAIN_HEADERCHAINCACHE_H
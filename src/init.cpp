@@ -17,6 +17,7 @@
 #include "activemasternode.h"
 #include "addrman.h"
 #include "amount.h"
+#include "blockprevalidation.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
@@ -39,6 +40,7 @@
 #include "rpc/server.h"
 #include "script/standard.h"
 #include "scheduler.h"
+#include "signatureprevalidation.h"
 #include "spork.h"
 #include "sporkdb.h"
 #include "txdb.h"
@@ -243,6 +245,10 @@ void PrepareShutdown()
     threadGroup.interrupt_all();
     threadGroup.join_all();
 
+    // Deliver the notifications still queued for the scheduler, later ones are sent directly
+    FlushBackgroundCallbacks();
+    UnregisterBackgroundSignalScheduler();
+
     if (fFeeEstimatesInitialized) {
         fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
         CAutoFile est_fileout(fsbridge::fopen(est_path, "wb"), SER_DISK, CLIENT_VERSION);
@@ -399,6 +405,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
+    strUsage += HelpMessageOpt("-blockprevalidationthreads=<n>", strprintf(_("Set the number of threads checking queued block signatures ahead of validation (0 to %d, default: %d)"), MAX_BLOCK_PREVALIDATION_THREADS, DEFAULT_BLOCK_PREVALIDATION_THREADS));
     strUsage += HelpMessageOpt("-blocksizenotify=<cmd>", _("Execute command when the best block changes and its size is over (%s in cmd is replaced by block hash, %d with the block size)"));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), RPDCHAIN_CONF_FILENAME));
@@ -415,6 +422,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf(_("Set the Maximum reorg depth (default: %u)"), DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-maxorphantxsize=<n>", strprintf(_("Keep at most <n> MB of unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
@@ -424,6 +432,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-reindexmoneysupply", strprintf(_("Reindex the %s and z%s money supply statistics"), CURRENCY_UNIT, CURRENCY_UNIT) + " " + _("on startup"));
     strUsage += HelpMessageOpt("-resync", _("Delete blockchain folders and resync from scratch") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-sigprevalidationthreads=<n>", strprintf(_("Set the number of threads checking queued masternode ping, winner and budget vote signatures (0 to %d, default: %d)"), MAX_SIGNATURE_PREVALIDATION_THREADS, DEFAULT_SIGNATURE_PREVALIDATION_THREADS));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
@@ -446,6 +455,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msghandthreads=<n>", strprintf(_("Number of threads processing peer messages (1 to %d, default: %d)"), MAX_MESSAGE_HANDLER_THREADS, DEFAULT_MESSAGE_HANDLER_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -1192,6 +1202,16 @@ bool AppInit2()
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    int nBlockPreValidationThreads = std::max(0, std::min((int)GetArg("-blockprevalidationthreads", DEFAULT_BLOCK_PREVALIDATION_THREADS), MAX_BLOCK_PREVALIDATION_THREADS));
+    LogPrintf("Using %u threads for block pre-validation\n", nBlockPreValidationThreads);
+    for (int i = 0; i < nBlockPreValidationThreads; i++)
+        threadGroup.create_thread(&ThreadBlockPreValidation);
+
+    int nSignaturePreValidationThreads = std::max(0, std::min((int)GetArg("-sigprevalidationthreads", DEFAULT_SIGNATURE_PREVALIDATION_THREADS), MAX_SIGNATURE_PREVALIDATION_THREADS));
+    LogPrintf("Using %u threads for signature pre-validation\n", nSignaturePreValidationThreads);
+    for (int i = 0; i < nSignaturePreValidationThreads; i++)
+        threadGroup.create_thread(&ThreadSignaturePreValidation);
+
     if (mapArgs.count("-sporkkey")) // spork priv key
     {
         if (!sporkManager.SetPrivKey(GetArg("-sporkkey", "")))
@@ -1202,6 +1222,9 @@ bool AppInit2()
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
+    // Validation notifications are delivered from the scheduler thread
+    RegisterBackgroundSignalScheduler(scheduler);
+
     if (Params().IsRegTestNet()) { // only for regtest for now
         // Initialize Sapling circuit parameters
         LoadSaplingParams();
@@ -1813,7 +1836,9 @@ bool AppInit2()
 
     CMasternodeDB mndb;
     CMasternodeDB::ReadResult readResult = mndb.Read(mnodeman);
-    if (readResult == CMasternodeDB::FileError)
+    if (readResult == CMasternodeDB::Ok)
+        mnodeman.CheckAndRemove(true);
+    else if (readResult == CMasternodeDB::FileError)
         LogPrintf("Missing masternode cache file - mncache.dat, will try to recreate\n");
     else if (readResult != CMasternodeDB::Ok) {
         LogPrintf("Error reading mncache.dat: ");
@@ -1828,7 +1853,9 @@ bool AppInit2()
     CBudgetDB budgetdb;
     int nChainHeight = WITH_LOCK(cs_main, return chainActive.Height(); );
     const bool fDryRun = (nChainHeight <= 0);
-    CBudgetDB::ReadResult readResult2 = budgetdb.Read(budget, fDryRun);
+    CBudgetDB::ReadResult readResult2 = budgetdb.Read(budget);
+    if (readResult2 == CBudgetDB::Ok && !fDryRun)
+        budget.CheckAndRemove();
     if (nChainHeight > 0)
         budget.SetBestHeight(nChainHeight);
 
@@ -1852,7 +1879,9 @@ bool AppInit2()
     CMasternodePaymentDB mnpayments;
     CMasternodePaymentDB::ReadResult readResult3 = mnpayments.Read(masternodePayments);
 
-    if (readResult3 == CMasternodePaymentDB::FileError)
+    if (readResult3 == CMasternodePaymentDB::Ok)
+        masternodePayments.CleanPaymentList();
+    else if (readResult3 == CMasternodePaymentDB::FileError)
         LogPrintf("Missing masternode payment cache - mnpayments.dat, will try to recreate\n");
     else if (readResult3 != CMasternodePaymentDB::Ok) {
         LogPrintf("Error reading mnpayments.dat: ");
@@ -1986,6 +2015,7 @@ bool AppInit2()
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000*GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.nMessageHandlerThreads = GetArg("-msghandthreads", DEFAULT_MESSAGE_HANDLER_THREADS);
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return UIError(strNodeError);
@@ -7,6 +7,7 @@
 
 #include "kernel.h"
 
+#include "crypto/common.h"
 #include "db.h"
 #include "legacy/stakemodifier.h"
 #include "script/interpreter.h"
@@ -19,6 +20,21 @@
 
 #include <boost/assign/list_of.hpp>
 
+// Serialize the stake modifier of a kernel on top of pindexPrev
+static void SetKernelStakeModifier(const CBlockIndex* const pindexPrev, CStakeInput* stakeInput, CDataStream& ss)
+{
+    if (!Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V3_4)) {
+        uint64_t nStakeModifier = 0;
+        if (!GetOldStakeModifier(stakeInput, nStakeModifier))
+            LogPrintf("%s : ERROR: Failed to get kernel stake modifier\n", __func__);
+        // Modifier v1
+        ss << nStakeModifier;
+    } else {
+        // Modifier v2
+        ss << pindexPrev->GetStakeModifierV2();
+    }
+}
+
 /**
  * CStakeKernel Constructor
  *
@@ -33,17 +49,7 @@ CStakeKernel::CStakeKernel(const CBlockIndex* const pindexPrev, CStakeInput* sta
     nBits(nBits),
     stakeValue(stakeInput->GetValue())
 {
-    // Set kernel stake modifier
-    if (!Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V3_4)) {
-        uint64_t nStakeModifier = 0;
-        if (!GetOldStakeModifier(stakeInput, nStakeModifier))
-            LogPrintf("%s : ERROR: Failed to get kernel stake modifier\n", __func__);
-        // Modifier v1
-        stakeModifier << nStakeModifier;
-    } else {
-        // Modifier v2
-        stakeModifier << pindexPrev->GetStakeModifierV2();
-    }
+    SetKernelStakeModifier(pindexPrev, stakeInput, stakeModifier);
     CBlockIndex* pindexFrom = stakeInput->GetIndexFrom();
     nTimeBlockFrom = pindexFrom->nTime;
 }
@@ -82,6 +88,51 @@ bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
     return res;
 }
 
+/**
+ * CStakeCandidate Constructor
+ *
+ * @param[in]   pindexPrev      index of the parent of the kernel block
+ * @param[in]   stakeInput      input for the coinstake, its GetIndexFrom must be set
+ * @param[in]   nBits           target difficulty bits of the kernel block
+ */
+CStakeCandidate::CStakeCandidate(const CBlockIndex* const pindexPrev, CStakeInput* stakeInput, unsigned int nBits)
+{
+    const CBlockIndex* pindexFrom = stakeInput->GetIndexFrom();
+    nHeightBlockFrom = pindexFrom->nHeight;
+    nTimeBlockFrom = pindexFrom->nTime;
+
+    // same message as CStakeKernel::GetHash, but for the block time
+    CDataStream ss(SER_GETHASH, 0);
+    SetKernelStakeModifier(pindexPrev, stakeInput, ss);
+    ss << (int)nTimeBlockFrom << stakeInput->GetUniqueness();
+    hasher.Write((const unsigned char*)&ss.begin()[0], ss.size());
+
+    // same target as CStakeKernel::CheckKernelHash
+    bnTarget.SetCompact(nBits);
+    bnTarget *= (uint256(stakeInput->GetValue()) / 100);
+}
+
+bool CStakeCandidate::ContextCheck(int nHeightTx, uint32_t nTimeTx) const
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    return !consensus.NetworkUpgradeActive(nHeightTx + 1, Consensus::UPGRADE_ZC_PUBLIC) ||
+           consensus.HasStakeMinAgeOrDepth(nHeightTx, nTimeTx, nHeightBlockFrom, nTimeBlockFrom);
+}
+
+uint256 CStakeCandidate::GetHash(int nTimeTx) const
+{
+    unsigned char vchTime[4];
+    WriteLE32(vchTime, (uint32_t)nTimeTx);
+    uint256 hashProofOfStake;
+    CHash256(hasher).Write(vchTime, sizeof(vchTime)).Finalize(hashProofOfStake.begin());
+    return hashProofOfStake;
+}
+
+bool CStakeCandidate::CheckKernelHash(int nTimeTx) const
+{
+    return GetHash(nTimeTx) < bnTarget;
+}
+
 
 /*
  * PoS Validation
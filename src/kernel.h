@@ -8,6 +8,7 @@
 #ifndef RPDCHAIN_KERNEL_H
 #define RPDCHAIN_KERNEL_H
 
+#include "hash.h"
 #include "main.h"
 #include "stakeinput.h"
 
@@ -40,6 +41,43 @@ private:
     CAmount stakeValue{0};     // target multiplier
 };
 
+/**
+ * Stake kernel of an input on top of a given tip, for any block time.
+ *
+ * Everything in the kernel but the block time (stake modifier, origin block
+ * time, uniqueness and the weighted target) is computed once, and the kernel
+ * message hashed up to the block time, so checking a time slot only hashes
+ * the time in: no allocation, serialization or disk access per attempt.
+ * The hash is the same as CStakeKernel::GetHash.
+ */
+class CStakeCandidate {
+public:
+    /**
+     * CStakeCandidate Constructor
+     *
+     * @param[in]   pindexPrev      index of the parent of the kernel block
+     * @param[in]   stakeInput      input for the coinstake, its GetIndexFrom must be set
+     * @param[in]   nBits           target difficulty bits of the kernel block
+     */
+    CStakeCandidate(const CBlockIndex* const pindexPrev, CStakeInput* stakeInput, unsigned int nBits);
+
+    // Stake input contextual checks (see CRpdStake::ContextCheck), without logging
+    bool ContextCheck(int nHeightTx, uint32_t nTimeTx) const;
+
+    // Return the stake kernel hash for the block time
+    uint256 GetHash(int nTimeTx) const;
+
+    // Check that the kernel hash for the block time meets the target required
+    bool CheckKernelHash(int nTimeTx) const;
+
+private:
+    // kernel message hashed up to the block time
+    CHash256 hasher;
+    uint256 bnTarget;
+    int nHeightBlockFrom{0};
+    uint32_t nTimeBlockFrom{0};
+};
+
 /* PoS Validation */
 
 /*
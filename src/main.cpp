@@ -12,6 +12,7 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "blockprevalidation.h"
 #include "blocksignature.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -22,6 +23,7 @@
 #include "consensus/validation.h"
 #include "consensus/zerocoin_verify.h"
 #include "fs.h"
+#include "headerchaincache.h"
 #include "init.h"
 #include "kernel.h"
 #include "masternode-budget.h"
@@ -34,6 +36,7 @@
 #include "netbase.h"
 #include "policy/policy.h"
 #include "pow.h"
+#include "signatureprevalidation.h"
 #include "spork.h"
 #include "sporkdb.h"
 #include "swifttx.h"
@@ -82,6 +85,36 @@ RecursiveMutex cs_main;
 
 BlockMap mapBlockIndex;
 CChain chainActive;
+
+/**
+ * Storage for the entries of mapBlockIndex. Entries are never freed one by one
+ * (they live until shutdown), so they are carved out of large chunks instead
+ * of being allocated individually. Protected by cs_main.
+ */
+class CBlockIndexArena
+{
+private:
+    static const size_t CHUNK_SIZE = 4096;
+    std::vector<std::unique_ptr<CBlockIndex[]> > vChunks;
+    size_t nUsedInChunk{CHUNK_SIZE};
+
+public:
+    CBlockIndex* Allocate()
+    {
+        if (nUsedInChunk == CHUNK_SIZE) {
+            vChunks.emplace_back(new CBlockIndex[CHUNK_SIZE]);
+            nUsedInChunk = 0;
+        }
+        return &vChunks.back()[nUsedInChunk++];
+    }
+
+    void Clear()
+    {
+        vChunks.clear();
+        nUsedInChunk = CHUNK_SIZE;
+    }
+};
+static CBlockIndexArena blockIndexArena;
 CBlockIndex* pindexBestHeader = NULL;
 int64_t nTimeBestReceived = 0;
 int64_t nMoneySupply;
@@ -113,9 +146,15 @@ CTxMemPool mempool(::minRelayTxFee);
 struct COrphanTx {
     CTransaction tx;
     NodeId fromPeer;
+    int64_t nTimeExpire;
+    unsigned int nTxSize;
 };
 std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(cs_main);
-std::map<uint256, std::set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);
+//! Orphans waiting on each missing outpoint
+std::map<COutPoint, std::set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);
+//! Serialized size of the orphans, in total and per announcing peer
+size_t nOrphanTransactionsSize GUARDED_BY(cs_main) = 0;
+std::map<NodeId, size_t> mapOrphanTransactionsSizeByPeer GUARDED_BY(cs_main);
 std::map<uint256, int64_t> mapRejectedBlocks;
 
 void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -686,6 +725,33 @@ CBlockIndex* GetChainTip()
     return mapBlockIndex.at(p->GetBlockHash());
 }
 
+static ChainTipSnapshotRef g_chain_tip_snapshot = std::make_shared<const CChainTipSnapshot>();
+
+/** Publish a new tip snapshot. Must be called whenever chainActive changes tip. */
+static void PublishChainTipSnapshot(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::shared_ptr<CChainTipSnapshot> snapshot = std::make_shared<CChainTipSnapshot>();
+    if (pindex) {
+        snapshot->pindex = pindex;
+        snapshot->nHeight = pindex->nHeight;
+        snapshot->hashBlock = pindex->GetBlockHash();
+        snapshot->nTime = pindex->GetBlockTime();
+        snapshot->nMedianTimePast = pindex->GetMedianTimePast();
+        snapshot->nChainWork = pindex->nChainWork;
+    }
+    std::atomic_store(&g_chain_tip_snapshot, ChainTipSnapshotRef(std::move(snapshot)));
+}
+
+ChainTipSnapshotRef GetChainTipSnapshot()
+{
+    return std::atomic_load(&g_chain_tip_snapshot);
+}
+
+int GetChainHeight()
+{
+    return GetChainTipSnapshot()->nHeight;
+}
+
 CCoinsViewCache* pcoinsTip = NULL;
 CBlockTreeDB* pblocktree = NULL;
 CZerocoinDB* zerocoinDB = NULL;
@@ -696,6 +762,11 @@ CSporkDB* pSporkDB = NULL;
 // mapOrphanTransactions
 //
 
+static size_t GetMaxOrphanTxSize()
+{
+    return (size_t)std::max((int64_t)0, GetArg("-maxorphantxsize", DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE)) * 1000000;
+}
+
 bool AddOrphanTx(const CTransaction& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     uint256 hash = tx.GetHash();
@@ -715,13 +786,28 @@ bool AddOrphanTx(const CTransaction& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(c
         return false;
     }
 
-    mapOrphanTransactions[hash].tx = tx;
-    mapOrphanTransactions[hash].fromPeer = peer;
+    // A single peer may only fill its share of the pool, so it cannot
+    // evict everybody else's orphans with its own.
+    size_t& nPeerSize = mapOrphanTransactionsSizeByPeer[peer];
+    if (nPeerSize + sz > GetMaxOrphanTxSize() / ORPHAN_TX_PEER_SHARE) {
+        LogPrint(BCLog::MEMPOOL, "ignoring orphan tx %s, peer=%d is over its orphan quota (%u bytes)\n", hash.ToString(), peer, nPeerSize);
+        if (nPeerSize == 0)
+            mapOrphanTransactionsSizeByPeer.erase(peer);
+        return false;
+    }
+
+    COrphanTx& orphan = mapOrphanTransactions[hash];
+    orphan.tx = tx;
+    orphan.fromPeer = peer;
+    orphan.nTimeExpire = GetTime() + ORPHAN_TX_EXPIRE_TIME;
+    orphan.nTxSize = sz;
     for (const CTxIn& txin : tx.vin)
-        mapOrphanTransactionsByPrev[txin.prevout.hash].insert(hash);
+        mapOrphanTransactionsByPrev[txin.prevout].insert(hash);
+    nPeerSize += sz;
+    nOrphanTransactionsSize += sz;
 
-    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u prevsz %u)\n", hash.ToString(),
-        mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size());
+    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u prevsz %u, %u bytes)\n", hash.ToString(),
+        mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size(), nOrphanTransactionsSize);
     return true;
 }
 
@@ -731,18 +817,27 @@ void static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     if (it == mapOrphanTransactions.end())
         return;
     for (const CTxIn& txin : it->second.tx.vin) {
-        std::map<uint256, std::set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout.hash);
+        std::map<COutPoint, std::set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
         if (itPrev == mapOrphanTransactionsByPrev.end())
             continue;
         itPrev->second.erase(hash);
         if (itPrev->second.empty())
             mapOrphanTransactionsByPrev.erase(itPrev);
     }
+    std::map<NodeId, size_t>::iterator itPeer = mapOrphanTransactionsSizeByPeer.find(it->second.fromPeer);
+    if (itPeer != mapOrphanTransactionsSizeByPeer.end()) {
+        itPeer->second -= it->second.nTxSize;
+        if (itPeer->second == 0)
+            mapOrphanTransactionsSizeByPeer.erase(itPeer);
+    }
+    nOrphanTransactionsSize -= it->second.nTxSize;
     mapOrphanTransactions.erase(it);
 }
 
 void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
+    if (!mapOrphanTransactionsSizeByPeer.count(peer))
+        return;
     int nErased = 0;
     std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
     while (iter != mapOrphanTransactions.end()) {
@@ -755,11 +850,39 @@ void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer %d\n", nErased, peer);
 }
 
+static void ClearOrphanTxs() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    mapOrphanTransactions.clear();
+    mapOrphanTransactionsByPrev.clear();
+    mapOrphanTransactionsSizeByPeer.clear();
+    nOrphanTransactionsSize = 0;
+}
 
-unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans, size_t nMaxOrphansSize) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
+    static int64_t nNextSweep;
+    int64_t nNow = GetTime();
+    if (nNextSweep <= nNow) {
+        // Sweep out expired orphans, then come back when the oldest remaining one expires
+        int nErased = 0;
+        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
+        std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
+        while (iter != mapOrphanTransactions.end()) {
+            std::map<uint256, COrphanTx>::iterator maybeErase = iter++;
+            if (maybeErase->second.nTimeExpire <= nNow) {
+                EraseOrphanTx(maybeErase->first);
+                ++nErased;
+            } else {
+                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
+            }
+        }
+        // Sweeping at most once per interval batches the expirations together
+        nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
+        if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
+    }
+
     unsigned int nEvicted = 0;
-    while (mapOrphanTransactions.size() > nMaxOrphans) {
+    while (mapOrphanTransactions.size() > nMaxOrphans || nOrphanTransactionsSize > nMaxOrphansSize) {
         // Evict a random orphan:
         uint256 randomhash = GetRandHash();
         std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.lower_bound(randomhash);
@@ -909,13 +1032,8 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
 
     // ----------- swiftTX transaction scanning -----------
 
-    for (const CTxIn& in : tx.vin) {
-        if (mapLockedInputs.count(in.prevout)) {
-            if (mapLockedInputs[in.prevout] != tx.GetHash()) {
-                return state.DoS(0, false, REJECT_INVALID, "tx-lock-conflict");
-            }
-        }
-    }
+    if (HasConflictingLock(tx))
+        return state.DoS(0, false, REJECT_INVALID, "tx-lock-conflict");
 
     bool hasZcSpendInputs = tx.HasZerocoinSpendInputs();
 
@@ -1134,7 +1252,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
             return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
     }
 
-    GetMainSignals().SyncTransaction(tx, nullptr, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+    GetMainSignals().QueueSyncTransaction(tx, nullptr, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
 
     TryToAddToMarkerCache(tx);
 
@@ -1177,14 +1295,10 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
 
     // ----------- swiftTX transaction scanning -----------
     std::string reason;
-    for (const CTxIn& in : tx.vin) {
-        if (mapLockedInputs.count(in.prevout)) {
-            if (mapLockedInputs[in.prevout] != tx.GetHash()) {
-                return state.DoS(0,
-                    error("AcceptableInputs : conflicts with existing transaction lock: %s", reason),
-                    REJECT_INVALID, "tx-lock-conflict");
-            }
-        }
+    if (HasConflictingLock(tx)) {
+        return state.DoS(0,
+            error("AcceptableInputs : conflicts with existing transaction lock: %s", reason),
+            REJECT_INVALID, "tx-lock-conflict");
     }
 
     // Check for conflicts with in-memory transactions
@@ -2276,6 +2390,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<uint256> vSpendsInBlock;
     uint256 hashBlock = block.GetHash();
 
+    //Temporarily disable zerocoin transactions for maintenance
+    const bool fZerocoinMaintenance = block.nTime > sporkManager.GetSporkValue(SPORK_16_ZEROCOIN_MAINTENANCE_MODE) && !IsInitialBlockDownload();
+
     std::vector<PrecomputedTransactionData> precomTxData;
     precomTxData.reserve(block.vtx.size()); // Required so that pointers to individual precomTxData don't get invalidated
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
@@ -2286,8 +2403,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (nSigOps > nMaxBlockSigOps)
             return state.DoS(100, error("ConnectBlock() : too many sigops"), REJECT_INVALID, "bad-blk-sigops");
 
-        //Temporarily disable zerocoin transactions for maintenance
-        if (block.nTime > sporkManager.GetSporkValue(SPORK_16_ZEROCOIN_MAINTENANCE_MODE) && !IsInitialBlockDownload() && tx.ContainsZerocoins()) {
+        if (fZerocoinMaintenance && tx.ContainsZerocoins()) {
             return state.DoS(100, error("ConnectBlock() : zerocoin transactions are currently in maintenance mode"));
         }
 
@@ -2524,7 +2640,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     // Watch for changes to the previous coinbase transaction.
     static uint256 hashPrevBestCoinBase;
-    GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
+    GetMainSignals().QueueUpdatedTransaction(hashPrevBestCoinBase);
     hashPrevBestCoinBase = block.vtx[0].GetHash();
 
     int64_t nTime4 = GetTimeMicros();
@@ -2666,6 +2782,8 @@ void FlushStateToDisk()
 void static UpdateTip(CBlockIndex* pindexNew)
 {
     chainActive.SetTip(pindexNew);
+    PublishChainTipSnapshot(pindexNew);
+    headerChainCache.SetTip(pindexNew);
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -2746,6 +2864,7 @@ bool static DisconnectTip(CValidationState& state)
     mempool.UpdateTransactionsFromBlock(vHashUpdate);
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev);
+    mnodeman.CollateralsBlockDisconnected(block);
 
     //! Omni Core: begin block disconnect notification
     // // LogPrint("handler", "Omni Core handler: block disconnect begin [height: %d, reindex: %d]\n", GetHeight(), (int)fReindex);
@@ -2754,7 +2873,7 @@ bool static DisconnectTip(CValidationState& state)
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     for (const CTransaction& tx : block.vtx) {
-        GetMainSignals().SyncTransaction(tx, pindexDelete->pprev, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+        GetMainSignals().QueueSyncTransaction(tx, pindexDelete->pprev, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
         TryToAddToMarkerCache(tx);
     }
 
@@ -2832,6 +2951,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const CB
     mempool.removeForBlock(pblock->vtx, pindexNew->nHeight, txConflicted, !IsInitialBlockDownload());
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
+    mnodeman.CollateralsBlockConnected(*pblock);
 
     for(unsigned int i=0; i < pblock->vtx.size(); i++) {
         txChanged.emplace_back(pblock->vtx[i], pindexNew, i);
@@ -3093,13 +3213,13 @@ bool ActivateBestChain(CValidationState& state, const CBlock* pblock, bool fAlre
 
             // throw all transactions though the signal-interface
             for (const CTransaction &tx : txConflicted) {
-                GetMainSignals().SyncTransaction(tx, pindexNewTip, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+                GetMainSignals().QueueSyncTransaction(tx, pindexNewTip, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
                 RemoveFromMarkerCache(tx);
             }
 
             // ... and about transactions that got confirmed:
             for(unsigned int i = 0; i < txChanged.size(); i++) {
-                GetMainSignals().SyncTransaction(std::get<0>(txChanged[i]), std::get<1>(txChanged[i]), std::get<2>(txChanged[i]));
+                GetMainSignals().QueueSyncTransaction(std::get<0>(txChanged[i]), std::get<1>(txChanged[i]), std::get<2>(txChanged[i]));
 
                 //! Omni Core: new confirmed transaction notification
                 // // LogPrint("handler", "Omni Core handler: new confirmed transaction [height: %d, idx: %u]\n", GetHeight(), nTxIdx);
@@ -3140,7 +3260,7 @@ bool ActivateBestChain(CValidationState& state, const CBlock* pblock, bool fAlre
                     }
                 }
                 // Notify external listeners about the new tip.
-                GetMainSignals().UpdatedBlockTip(pindexNewTip);
+                GetMainSignals().QueueUpdatedBlockTip(pindexNewTip);
 
                 unsigned size = 0;
                 if (pblock)
@@ -3245,8 +3365,8 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3530,16 +3650,10 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     // ----------- swiftTX transaction scanning -----------
     if (sporkManager.IsSporkActive(SPORK_3_SWIFTTX_BLOCK_FILTERING)) {
         for (const CTransaction& tx : block.vtx) {
-            if (!tx.IsCoinBase()) {
-                //only reject blocks when it's based on complete consensus
-                for (const CTxIn& in : tx.vin) {
-                    if (mapLockedInputs.count(in.prevout)) {
-                        if (mapLockedInputs[in.prevout] != tx.GetHash()) {
-                            mapRejectedBlocks.insert(std::make_pair(block.GetHash(), GetTime()));
-                            return state.DoS(100, false, REJECT_INVALID, "conflicting-tx-ix", false, "conflicting tx with instantsend lock");
-                        }
-                    }
-                }
+            //only reject blocks when it's based on complete consensus
+            if (!tx.IsCoinBase() && HasConflictingLock(tx)) {
+                mapRejectedBlocks.insert(std::make_pair(block.GetHash(), GetTime()));
+                return state.DoS(100, false, REJECT_INVALID, "conflicting-tx-ix", false, "conflicting tx with instantsend lock");
             }
         }
     } else {
@@ -4188,7 +4302,18 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, const CBlock* pblock
     // After 5.0, this can be removed and replaced by the enforcement block time.
     const int newHeight = chainActive.Height() + 1;
     const bool enableP2PKH = consensus.NetworkUpgradeActive(newHeight, Consensus::UPGRADE_V5_DUMMY);
-    if (!CheckBlockSignature(*pblock, enableP2PKH))
+
+    // Reuse the signature check done by the pre-validation workers, if any.
+    // Only valid once CheckBlock has matched the transactions with the header.
+    CBlockPreValidationResult preValidation;
+    bool fSigValid;
+    if (checked && blockPreValidator.GetResult(pblock->GetHash(), pblock->vchBlockSig, preValidation) &&
+            preValidation.fEnableP2PKH == enableP2PKH) {
+        fSigValid = preValidation.fSigValid;
+    } else {
+        fSigValid = CheckBlockSignature(*pblock, enableP2PKH);
+    }
+    if (!fSigValid)
         return error("%s : bad proof-of-stake block signature", __func__);
 
     if (pblock->GetHash() != consensus.hashGenesisBlock && pfrom != NULL) {
@@ -4238,13 +4363,17 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, const CBlock* pblock
         }
     }
 
+    // Don't let the notification queue grow without bound while listeners lag behind.
+    // Done here rather than in ActivateBestChain, which AcceptBlock can reach with cs_main held.
+    LimitValidationInterfaceQueue();
+
     if (!ActivateBestChain(state, pblock, checked, connman))
         return error("%s : ActivateBestChain failed", __func__);
 
     if (!fLiteMode) {
         budget.NewBlock(newHeight);
         if (masternodeSync.RequestedMasternodeAssets > MASTERNODE_SYNC_LIST) {
-            masternodePayments.ProcessBlock(newHeight + 10);
+            masternodePayments.QueueBlock(newHeight + 10);
         }
     }
 
@@ -4354,9 +4483,7 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error("LoadBlockIndex() : new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
 
     pindexNew->phashBlock = &((*mi).first);
@@ -4462,6 +4589,8 @@ bool static LoadBlockIndexDB(std::string& strError)
     if (it == mapBlockIndex.end())
         return true;
     chainActive.SetTip(it->second);
+    PublishChainTipSnapshot(it->second);
+    headerChainCache.SetTip(it->second);
 
     PruneBlockIndexCandidates();
 
@@ -4570,11 +4699,12 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    PublishChainTipSnapshot(nullptr);
+    headerChainCache.SetTip(nullptr);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
-    mapOrphanTransactions.clear();
-    mapOrphanTransactionsByPrev.clear();
+    ClearOrphanTxs();
     nSyncStarted = 0;
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
@@ -4589,10 +4719,8 @@ void UnloadBlockIndex()
     mapNodeState.clear();
     recentRejects.reset(nullptr);
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
 }
 
 bool LoadBlockIndex(std::string& strError)
@@ -5037,10 +5165,46 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/**
+ * Messages are processed by several threads, one peer at a time per thread.
+ * Handlers that read or update state without a lock of its own (masternode,
+ * payment and SwiftTX relay maps, sync status, orphans) rely on running
+ * alone, so they are serialized by this lock, taken before cs_main.
+ */
+static RecursiveMutex cs_msgProcSerial;
+
+/**
+ * Whether a message only touches per-peer state, cs_main or self-locked structures (addrman, active sporks).
+ * SPORK is not one of them: it writes mapSporks, which AlreadyHave and getdata read without the spork lock.
+ */
+static bool IsParallelMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::PING ||
+           strCommand == NetMsgType::PONG ||
+           strCommand == NetMsgType::ADDR ||
+           strCommand == NetMsgType::GETADDR ||
+           strCommand == NetMsgType::GETBLOCKS ||
+           strCommand == NetMsgType::GETHEADERS ||
+           strCommand == NetMsgType::GETDATA ||
+           strCommand == NetMsgType::GETSPORKS;
+}
+
+/** Responses to getdata for objects most peers ask for at about the same time. */
+static CSharedNetMsgCache sharedMsgCache(MAX_SHARED_MSG_CACHE_SIZE);
+
 void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
     AssertLockNotHeld(cs_main);
 
+    if (pfrom->vRecvGetData.empty())
+        return;
+
+    // A block request is served alone (see the loop below) and can go in parallel,
+    // relay objects come from maps owned by the serialized handlers.
+    const CInv& invFirst = pfrom->vRecvGetData.front();
+    const bool fBlockRequest = invFirst.type == MSG_BLOCK || invFirst.type == MSG_FILTERED_BLOCK;
+    LOCK(fBlockRequest ? nullptr : &cs_msgProcSerial);
+
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
     std::vector<CInv> vNotFound;
     CNetMsgMaker msgMaker(pfrom->GetSendVersion());
@@ -5077,13 +5241,18 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                 // Don't send not-validated blocks
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
                     // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second))
-                        assert(!"cannot load block from disk");
-                    if (inv.type == MSG_BLOCK)
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
-                    else // MSG_FILTERED_BLOCK)
+                    if (inv.type == MSG_BLOCK) {
+                        connman.PushMessage(pfrom, sharedMsgCache.Get(inv, pfrom->GetSendVersion(), 0, [&]() {
+                            CBlock block;
+                            if (!ReadBlockFromDisk(block, (*mi).second))
+                                assert(!"cannot load block from disk");
+                            return msgMaker.Make(NetMsgType::BLOCK, block);
+                        }));
+                    } else // MSG_FILTERED_BLOCK)
                     {
+                        CBlock block;
+                        if (!ReadBlockFromDisk(block, (*mi).second))
+                            assert(!"cannot load block from disk");
                         bool send = false;
                         CMerkleBlock merkleBlock;
                         {
@@ -5163,10 +5332,12 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                 }
                 if (!pushed && inv.type == MSG_SPORK) {
                     if (mapSporks.count(inv.hash)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mapSporks[inv.hash];
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, ss));
+                        connman.PushMessage(pfrom, sharedMsgCache.Get(inv, pfrom->GetSendVersion(), 0, [&]() {
+                            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                            ss.reserve(1000);
+                            ss << mapSporks[inv.hash];
+                            return msgMaker.Make(NetMsgType::SPORK, ss);
+                        }));
                         pushed = true;
                     }
                 }
@@ -5209,10 +5380,14 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
 
                 if (!pushed && inv.type == MSG_MASTERNODE_ANNOUNCE) {
                     if (mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mnodeman.mapSeenMasternodeBroadcast[inv.hash];
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNBROADCAST, ss));
+                        // the seen broadcast gets its last ping updated in place
+                        const CMasternodeBroadcast& mnb = mnodeman.mapSeenMasternodeBroadcast[inv.hash];
+                        connman.PushMessage(pfrom, sharedMsgCache.Get(inv, pfrom->GetSendVersion(), mnb.lastPing.sigTime, [&]() {
+                            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                            ss.reserve(1000);
+                            ss << mnb;
+                            return msgMaker.Make(NetMsgType::MNBROADCAST, ss);
+                        }));
                         pushed = true;
                     }
                 }
@@ -5547,6 +5722,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             LogPrint(BCLog::NET, "received getdata for: %s peer=%d\n", vInv[0].ToString(), pfrom->id);
 
         pfrom->vRecvGetData.insert(pfrom->vRecvGetData.end(), vInv.begin(), vInv.end());
+        // counted in the process time of this message, nGetDataTime is for the requests left over
         ProcessGetData(pfrom, connman, interruptMsgProc);
     }
 
@@ -5562,29 +5738,30 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             return true;
         }
 
-        LOCK(cs_main);
-
-        // Find the last block the caller has in the main chain
-        CBlockIndex* pindex = FindForkInGlobalIndex(chainActive, locator);
+        // Find the last block the caller has in the main chain, from the
+        // header chain cache, which follows chainActive without cs_main
+        int nHeight = headerChainCache.FindFork(locator);
 
         // Send the rest of the chain
-        if (pindex)
-            pindex = chainActive.Next(pindex);
+        if (nHeight >= 0)
+            nHeight++;
         int nLimit = 500;
-        LogPrint(BCLog::NET, "getblocks %d to %s limit %d from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), nLimit, pfrom->id);
-        for (; pindex; pindex = chainActive.Next(pindex)) {
-            if (pindex->GetBlockHash() == hashStop) {
-                LogPrint(BCLog::NET, "  getblocks stopping at %d %s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+        std::vector<uint256> vHashes = headerChainCache.GetHashes(nHeight, nLimit);
+        LogPrint(BCLog::NET, "getblocks %d to %s limit %d from peer=%d\n", (vHashes.empty() ? -1 : nHeight), hashStop.IsNull() ? "end" : hashStop.ToString(), nLimit, pfrom->id);
+        for (const uint256& hash : vHashes) {
+            if (hash == hashStop) {
+                LogPrint(BCLog::NET, "  getblocks stopping at %d %s\n", nHeight, hash.ToString());
                 break;
             }
-            pfrom->PushInventory(CInv(MSG_BLOCK, pindex->GetBlockHash()));
+            pfrom->PushInventory(CInv(MSG_BLOCK, hash));
             if (--nLimit <= 0) {
                 // When this block is requested, we'll send an inv that'll make them
                 // getblocks the next batch of inventory.
-                LogPrint(BCLog::NET, "  getblocks stopping at limit %d %s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-                pfrom->hashContinue = pindex->GetBlockHash();
+                LogPrint(BCLog::NET, "  getblocks stopping at limit %d %s\n", nHeight, hash.ToString());
+                pfrom->hashContinue = hash;
                 break;
             }
+            nHeight++;
         }
     }
 
@@ -5600,40 +5777,42 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             return true;
         }
 
-        LOCK(cs_main);
-
         if (IsInitialBlockDownload())
             return true;
 
-        CBlockIndex* pindex = NULL;
+        int nHeight = -1;
         if (locator.IsNull()) {
             // If locator is null, return the hashStop block
-            BlockMap::iterator mi = mapBlockIndex.find(hashStop);
-            if (mi == mapBlockIndex.end())
+            nHeight = headerChainCache.GetHeight(hashStop);
+            if (nHeight < 0) {
+                // not on the active chain, so it is sent alone
+                LOCK(cs_main);
+                BlockMap::iterator mi = mapBlockIndex.find(hashStop);
+                if (mi == mapBlockIndex.end())
+                    return true;
+                // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
+                std::vector<CBlock> vHeaders(1, CBlock(mi->second->GetBlockHeader()));
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
                 return true;
-            pindex = (*mi).second;
+            }
         } else {
             // Find the last block the caller has in the main chain
-            pindex = FindForkInGlobalIndex(chainActive, locator);
-            if (pindex)
-                pindex = chainActive.Next(pindex);
-        }
-
-        // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
-        std::vector<CBlock> vHeaders;
-        int nLimit = MAX_HEADERS_RESULTS;
-        LogPrintf("getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.ToString(), pfrom->id);
-        for (; pindex; pindex = chainActive.Next(pindex)) {
-            vHeaders.push_back(pindex->GetBlockHeader());
-            if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
-                break;
+            nHeight = headerChainCache.FindFork(locator);
+            if (nHeight >= 0)
+                nHeight++;
         }
-        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+
+        // The response is a slice of the cached serialized headers, no cs_main needed
+        CSerializedNetMsg msg;
+        msg.command = NetMsgType::HEADERS;
+        headerChainCache.GetHeaders(nHeight, MAX_HEADERS_RESULTS, hashStop, msg.data);
+        LogPrintf("getheaders %d to %s from peer=%d\n", nHeight, hashStop.ToString(), pfrom->id);
+        connman.PushMessage(pfrom, std::move(msg));
     }
 
 
     else if (strCommand == NetMsgType::TX) {
-        std::vector<uint256> vWorkQueue;
+        std::vector<COutPoint> vWorkQueue;
         std::vector<uint256> vEraseQueue;
         CTransaction tx;
 
@@ -5658,16 +5837,19 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         if (!tx.HasZerocoinSpendInputs() && AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs, false, ignoreFees)) {
             mempool.check(pcoinsTip);
             RelayTransaction(tx, connman);
-            vWorkQueue.push_back(inv.hash);
+            for (unsigned int i = 0; i < tx.vout.size(); i++)
+                vWorkQueue.emplace_back(inv.hash, i);
 
             LogPrint(BCLog::MEMPOOL, "%s : peer=%d %s : accepted %s (poolsz %u txn, %u kB)\n",
                     __func__, pfrom->id, pfrom->cleanSubVer, tx.GetHash().ToString(),
                     mempool.size(), mempool.DynamicMemoryUsage() / 1000);
 
             // Recursively process any orphan transactions that depended on this one
+            // Only the orphans spending one of its outputs are looked at
             std::set<NodeId> setMisbehaving;
+            std::set<uint256> setProcessed;
             for(unsigned int i = 0; i < vWorkQueue.size(); i++) {
-                std::map<uint256, std::set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
+                std::map<COutPoint, std::set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
                 if(itByPrev == mapOrphanTransactionsByPrev.end())
                     continue;
                 for(std::set<uint256>::iterator mi = itByPrev->second.begin();
@@ -5683,12 +5865,14 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                     CValidationState stateDummy;
 
 
-                    if(setMisbehaving.count(fromPeer))
+                    if(setMisbehaving.count(fromPeer) || setProcessed.count(orphanHash))
                         continue;
                     if(AcceptToMemoryPool(mempool, stateDummy, orphanTx, true, &fMissingInputs2)) {
                         LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
                         RelayTransaction(orphanTx, connman);
-                        vWorkQueue.push_back(orphanHash);
+                        for (unsigned int j = 0; j < orphanTx.vout.size(); j++)
+                            vWorkQueue.emplace_back(orphanHash, j);
+                        setProcessed.insert(orphanHash);
                         vEraseQueue.push_back(orphanHash);
                     } else if(!fMissingInputs2) {
                         int nDos = 0;
@@ -5702,6 +5886,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                         // Probably non-standard or insufficient fee/priority
                         LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
                         vEraseQueue.push_back(orphanHash);
+                        setProcessed.insert(orphanHash);
                         assert(recentRejects);
                         recentRejects->insert(orphanHash);
                     }
@@ -5720,13 +5905,33 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                      tx.GetHash().ToString(),
                      mempool.mapTx.size());
         } else if (fMissingInputs) {
-            AddOrphanTx(tx, pfrom->GetId());
+            assert(recentRejects);
+            bool fRejectedParents = false;
+            for (const CTxIn& txin : tx.vin) {
+                if (recentRejects->contains(txin.prevout.hash)) {
+                    fRejectedParents = true;
+                    break;
+                }
+            }
+            if (fRejectedParents) {
+                // A parent was rejected, so the orphan can never be accepted
+                LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n", tx.GetHash().ToString());
+                recentRejects->insert(tx.GetHash());
+            } else if (AddOrphanTx(tx, pfrom->GetId())) {
+                // Fetch the missing parents from the peer that announced the orphan
+                for (const CTxIn& txin : tx.vin) {
+                    CInv parentInv(MSG_TX, txin.prevout.hash);
+                    pfrom->AddInventoryKnown(parentInv);
+                    if (!AlreadyHave(parentInv))
+                        pfrom->AskFor(parentInv);
+                }
 
-            // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
-            unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-            unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
-            if (nEvicted > 0)
-                LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+                // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+                unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+                unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx, GetMaxOrphanTxSize());
+                if (nEvicted > 0)
+                    LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+            }
         } else {
             // AcceptToMemoryPool() returned false, possibly because the tx is
             // already in the mempool; if the tx isn't in the mempool that
@@ -5870,7 +6075,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     // Making users (which are behind NAT and can only make outgoing connections) ignore
     // getaddr message mitigates the attack.
     else if ((strCommand == NetMsgType::GETADDR) && (pfrom->fInbound)) {
-        pfrom->vAddrToSend.clear();
+        WITH_LOCK(pfrom->cs_addrSend, pfrom->vAddrToSend.clear());
         std::vector<CAddress> vAddr = connman.GetAddresses();
         FastRandomContext insecure_rand;
         for (const CAddress& addr : vAddr)
@@ -6113,8 +6318,11 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
     //
     bool fMoreWork = false;
 
-    if (!pfrom->vRecvGetData.empty())
+    if (!pfrom->vRecvGetData.empty()) {
+        int64_t nTimeStart = GetTimeMicros();
         ProcessGetData(pfrom, connman, interruptMsgProc);
+        pfrom->nGetDataTime += GetTimeMicros() - nTimeStart;
+    }
 
     if (pfrom->fDisconnect)
         return false;
@@ -6136,6 +6344,24 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
         pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
         fMoreWork = !pfrom->vProcessMsg.empty();
+
+        // Hand the blocks and signed masternode messages still waiting behind this
+        // message to the pre-validation workers, so their signatures get checked
+        // while we process this one.
+        if (fMoreWork) {
+            const bool fBlocks = blockPreValidator.IsEnabled();
+            const bool fSignedMessages = signaturePreValidator.IsEnabled();
+            for (CNetMessage& queued : pfrom->vProcessMsg) {
+                if (queued.fPreValidationQueued)
+                    continue;
+                queued.fPreValidationQueued = true;
+                const std::string strQueuedCommand = queued.hdr.GetCommand();
+                if (fBlocks && strQueuedCommand == NetMsgType::BLOCK)
+                    blockPreValidator.Submit(queued.vRecv, pfrom->GetRecvVersion());
+                else if (fSignedMessages && CSignaturePreValidator::IsSignedMessage(strQueuedCommand))
+                    signaturePreValidator.Submit(strQueuedCommand, queued.vRecv, pfrom->GetRecvVersion());
+            }
+        }
     }
     CNetMessage& msg(msgs.front());
 
@@ -6173,7 +6399,10 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
     // Process message
     bool fRet = false;
     try {
+        LOCK(IsParallelMessage(strCommand) ? nullptr : &cs_msgProcSerial);
+        int64_t nTimeStart = GetTimeMicros();
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc);
+        pfrom->AddProcessTime(strCommand, GetTimeMicros() - nTimeStart);
         if (interruptMsgProc)
             return false;
         if (!pfrom->vRecvGetData.empty())
@@ -6241,6 +6470,9 @@ bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interruptMsg
             }
         }
 
+        // AlreadyHave reads the relay maps owned by the serialized handlers, so requesting
+        // non-block objects waits for a round where no serialized handler is running.
+        TRY_LOCK(cs_msgProcSerial, lockSerial);
         TRY_LOCK(cs_main, lockMain); // Acquire cs_main for IsInitialBlockDownload() and CNodeState()
         if (!lockMain)
             return true;
@@ -6278,6 +6510,7 @@ bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interruptMsg
         //
         if (pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
+            LOCK(pto->cs_addrSend);
             std::vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
             for (const CAddress& addr : pto->vAddrToSend) {
@@ -6323,48 +6556,42 @@ bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interruptMsg
         // Message: inventory
         //
         std::vector<CInv> vInv;
-        std::vector<CInv> vInvWait;
+        std::vector<uint256> vTxToSend;
         {
+            LOCK(pto->cs_inventory);
+            vInv.swap(pto->vInventoryToSend);
+
+            // Trickle transactions out to protect privacy: everything queued for the
+            // peer is announced at once, on a randomized interval.
             bool fSendTrickle = pto->fWhitelisted;
             if (pto->nNextInvSend < nNow) {
                 fSendTrickle = true;
                 pto->nNextInvSend = PoissonNextSend(nNow, AVG_INVENTORY_BROADCAST_INTERVAL);
             }
+            if (fSendTrickle && !pto->setInventoryTxToSend.empty()) {
+                vTxToSend.assign(pto->setInventoryTxToSend.begin(), pto->setInventoryTxToSend.end());
+                pto->setInventoryTxToSend.clear();
+            }
+        }
+        if (!vTxToSend.empty()) {
+            mempool.SortForRelay(vTxToSend);
             LOCK(pto->cs_inventory);
-            vInv.reserve(pto->vInventoryToSend.size());
-            vInvWait.reserve(pto->vInventoryToSend.size());
-            for (const CInv& inv : pto->vInventoryToSend) {
-                if (inv.type == MSG_TX && pto->filterInventoryKnown.contains(inv.hash))
+            for (const uint256& hash : vTxToSend) {
+                if (pto->filterInventoryKnown.contains(hash))
                     continue;
-
-                // trickle out tx inv to protect privacy
-                if (inv.type == MSG_TX && !fSendTrickle) {
-                    // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
-                    uint256 hashRand = inv.hash ^ hashSalt;
-                    hashRand = Hash(BEGIN(hashRand), END(hashRand));
-                    bool fTrickleWait = ((hashRand & 3) != 0);
-
-                    if (fTrickleWait) {
-                        vInvWait.push_back(inv);
-                        continue;
-                    }
-                }
-
-                pto->filterInventoryKnown.insert(inv.hash);
-
-                vInv.push_back(inv);
-                if (vInv.size() >= 1000) {
-                    connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
-                    vInv.clear();
-                }
+                pto->filterInventoryKnown.insert(hash);
+                vInv.emplace_back(MSG_TX, hash);
+            }
+        }
+        if (vInv.size() <= MAX_INV_SEND_SZ) {
+            if (!vInv.empty())
+                connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+        } else {
+            for (size_t nStart = 0; nStart < vInv.size(); nStart += MAX_INV_SEND_SZ) {
+                std::vector<CInv> vInvMessage(vInv.begin() + nStart, vInv.begin() + std::min(vInv.size(), nStart + MAX_INV_SEND_SZ));
+                connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInvMessage));
             }
-            pto->vInventoryToSend = vInvWait;
         }
-        if (!vInv.empty())
-            connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
         // Detect whether we're stalling
         nNow = GetTimeMicros();
@@ -6412,7 +6639,7 @@ bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interruptMsg
         //
         // Message: getdata (non-blocks)
         //
-        while (!pto->mapAskFor.empty() && (*pto->mapAskFor.begin()).first <= nNow) {
+        while (lockSerial && !pto->mapAskFor.empty() && (*pto->mapAskFor.begin()).first <= nNow) {
             const CInv& inv = (*pto->mapAskFor.begin()).second;
             if (!AlreadyHave(inv)) {
                 LogPrint(BCLog::NET, "Requesting %s peer=%d\n", inv.ToString(), pto->id);
@@ -6443,13 +6670,10 @@ public:
     ~CMainCleanup()
     {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
 
         // orphan transactions
-        mapOrphanTransactions.clear();
-        mapOrphanTransactionsByPrev.clear();
+        ClearOrphanTxs();
     }
 } instance_of_cmaincleanup;
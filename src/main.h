@@ -39,6 +39,7 @@
 #include <atomic>
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -90,7 +91,15 @@ static const unsigned int DEFAULT_LIMITFREERELAY = 30;
 static const unsigned int MAX_STANDARD_TX_SIZE = 100000;
 static const unsigned int MAX_ZEROCOIN_TX_SIZE = 150000;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
-static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 1000;
+/** Default for -maxorphantxsize, maximum size in megabytes of the orphan transactions kept in memory */
+static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE = 5;
+/** A single peer's orphans may take at most 1/ORPHAN_TX_PEER_SHARE of -maxorphantxsize */
+static const unsigned int ORPHAN_TX_PEER_SHARE = 4;
+/** Expiration time for orphan transactions in seconds */
+static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
+/** Minimum time between orphan transactions expire time checks in seconds */
+static const int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
 /** Default for -checkblocks */
 static const signed int DEFAULT_CHECKBLOCKS = 10;
 /** The maximum size of a blk?????.dat file (since 0.8) */
@@ -126,8 +135,12 @@ static const unsigned int AVG_LOCAL_ADDRESS_BROADCAST_INTERVAL = 24 * 24 * 60;
 /** Average delay between peer address broadcasts in seconds. */
 static const unsigned int AVG_ADDRESS_BROADCAST_INTERVAL = 30;
 /** Average delay between trickled inventory broadcasts in seconds.
- *  Blocks, whitelisted receivers, and a random 25% of transactions bypass this. */
+ *  Blocks, masternode objects and whitelisted receivers bypass this. */
 static const unsigned int AVG_INVENTORY_BROADCAST_INTERVAL = 5;
+/** Maximum number of entries in an inv message we send */
+static const size_t MAX_INV_SEND_SZ = 1000;
+/** Maximum total payload of the getdata responses kept to be sent again to other peers */
+static const size_t MAX_SHARED_MSG_CACHE_SIZE = 4 * MAX_BLOCK_SIZE_CURRENT;
 
 /** Enable bloom filter */
  static const bool DEFAULT_PEERBLOOMFILTERS = true;
@@ -442,6 +455,27 @@ extern CSporkDB* pSporkDB;
  */
 CBlockIndex* GetChainTip();
 
+/**
+ * Immutable snapshot of the active chain tip. A new one is published each
+ * time chainActive changes tip, so readers that only need the tip height,
+ * hash or times don't have to take cs_main.
+ */
+struct CChainTipSnapshot {
+    const CBlockIndex* pindex{nullptr};   //!< entry in mapBlockIndex (never freed while running)
+    int nHeight{-1};
+    uint256 hashBlock{};
+    int64_t nTime{0};
+    int64_t nMedianTimePast{0};
+    uint256 nChainWork{};
+};
+typedef std::shared_ptr<const CChainTipSnapshot> ChainTipSnapshotRef;
+
+/** Return the last published tip snapshot (never null). Lock-free. */
+ChainTipSnapshotRef GetChainTipSnapshot();
+
+/** Height of the active chain, or -1 if empty. Lock-free. */
+int GetChainHeight();
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -16,6 +16,8 @@
 #include "netmessagemaker.h"
 #include "util.h"
 
+#include <limits>
+
 
 CBudgetManager budget;
 RecursiveMutex cs_budget;
@@ -242,159 +244,9 @@ void CBudgetManager::SubmitFinalBudget()
     LogPrint(BCLog::MNBUDGET,"%s: Done! %s\n", __func__, finalizedBudgetBroadcast.GetHash().ToString());
 }
 
-//
-// CBudgetDB
-//
-
-CBudgetDB::CBudgetDB()
-{
-    pathDB = GetDataDir() / "budget.dat";
-    strMagicMessage = "MasternodeBudget";
-}
-
-bool CBudgetDB::Write(const CBudgetManager& objToSave)
-{
-    LOCK(objToSave.cs);
-
-    int64_t nStart = GetTimeMillis();
-
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-    ssObj << strMagicMessage;                   // masternode cache file specific magic message
-    ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-    ssObj << objToSave;
-    uint256 hash = Hash(ssObj.begin(), ssObj.end());
-    ssObj << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathDB.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssObj;
-    } catch (const std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
-    }
-    fileout.fclose();
-
-    LogPrint(BCLog::MNBUDGET,"Written info to budget.dat  %dms\n", GetTimeMillis() - nStart);
-
-    return true;
-}
-
-CBudgetDB::ReadResult CBudgetDB::Read(CBudgetManager& objToLoad, bool fDryRun)
-{
-    LOCK(objToLoad.cs);
-
-    int64_t nStart = GetTimeMillis();
-    // open input file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "rb");
-    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        error("%s : Failed to open file %s", __func__, pathDB.string());
-        return FileError;
-    }
-
-    // use file size to size memory buffer
-    int fileSize = fs::file_size(pathDB);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
-
-    // read data and checksum from file
-    try {
-        filein.read((char*)&vchData[0], dataSize);
-        filein >> hashIn;
-    } catch (const std::exception& e) {
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return HashReadError;
-    }
-    filein.fclose();
-
-    CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
-    }
-
-
-    unsigned char pchMsgTmp[4];
-    std::string strMagicMessageTmp;
-    try {
-        // de-serialize file header (masternode cache file specific magic message) and ..
-        ssObj >> strMagicMessageTmp;
-
-        // ... verify the message matches predefined one
-        if (strMagicMessage != strMagicMessageTmp) {
-            error("%s : Invalid masternode cache magic message", __func__);
-            return IncorrectMagicMessage;
-        }
-
-
-        // de-serialize file header (network specific magic number) and ..
-        ssObj >> FLATDATA(pchMsgTmp);
-
-        // ... verify the network matches ours
-        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
-            error("%s : Invalid network magic number", __func__);
-            return IncorrectMagicNumber;
-        }
-
-        // de-serialize data into CBudgetManager object
-        ssObj >> objToLoad;
-    } catch (const std::exception& e) {
-        objToLoad.Clear();
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return IncorrectFormat;
-    }
-
-    LogPrint(BCLog::MNBUDGET,"Loaded info from budget.dat  %dms\n", GetTimeMillis() - nStart);
-    LogPrint(BCLog::MNBUDGET,"  %s\n", objToLoad.ToString());
-    if (!fDryRun) {
-        LogPrint(BCLog::MNBUDGET,"Budget manager - cleaning....\n");
-        objToLoad.CheckAndRemove();
-        LogPrint(BCLog::MNBUDGET,"Budget manager - result:\n");
-        LogPrint(BCLog::MNBUDGET,"  %s\n", objToLoad.ToString());
-    }
-
-    return Ok;
-}
-
 void DumpBudgets()
 {
-    int64_t nStart = GetTimeMillis();
-
-    CBudgetDB budgetdb;
-    CBudgetManager tempBudget;
-
-    LogPrint(BCLog::MNBUDGET,"Verifying budget.dat format...\n");
-    CBudgetDB::ReadResult readResult = budgetdb.Read(tempBudget, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CBudgetDB::FileError)
-        LogPrint(BCLog::MNBUDGET,"Missing budgets file - budget.dat, will try to recreate\n");
-    else if (readResult != CBudgetDB::Ok) {
-        LogPrint(BCLog::MNBUDGET,"Error reading budget.dat: ");
-        if (readResult == CBudgetDB::IncorrectFormat)
-            LogPrint(BCLog::MNBUDGET,"magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint(BCLog::MNBUDGET,"file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint(BCLog::MNBUDGET,"Writting info to budget.dat...\n");
-    budgetdb.Write(budget);
-
-    LogPrint(BCLog::MNBUDGET,"Budget dump finished  %dms\n", GetTimeMillis() - nStart);
+    CBudgetDB().Dump(budget);
 }
 
 bool CBudgetManager::AddFinalizedBudget(CFinalizedBudget& finalizedBudget)
@@ -1021,10 +873,25 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
     LOCK(cs_budget);
 
-    if (strCommand == NetMsgType::BUDGETVOTESYNC) { //Masternode vote sync
+    if (strCommand == NetMsgType::BUDGETVOTESYNC || strCommand == NetMsgType::BUDGETVOTESYNCDIFF) { //Masternode vote sync
         uint256 nProp;
         vRecv >> nProp;
 
+        // mnvsdiff carries a digest of the votes the peer already has
+        bool fDigest = strCommand == NetMsgType::BUDGETVOTESYNCDIFF;
+        CBudgetVoteSyncDigest digest;
+        if (fDigest) {
+            vRecv >> digest;
+            for (const auto& it : digest.mapBuckets) {
+                if (it.second.size() != BUDGET_VOTE_SYNC_BUCKETS) {
+                    LogPrint(BCLog::MNBUDGET,"mnvsdiff - invalid digest from peer %i\n", pfrom->GetId());
+                    LOCK(cs_main);
+                    Misbehaving(pfrom->GetId(), 20);
+                    return;
+                }
+            }
+        }
+
         if (Params().NetworkID() == CBaseChainParams::MAIN) {
             if (nProp.IsNull()) {
                 if (pfrom->HasFulfilledRequest("budgetvotesync")) {
@@ -1037,7 +904,7 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             }
         }
 
-        Sync(pfrom, nProp);
+        Sync(pfrom, nProp, false, fDigest ? &digest : nullptr);
         LogPrint(BCLog::MNBUDGET, "mnvs - Sent Masternode votes to peer %i\n", pfrom->GetId());
     }
 
@@ -1221,7 +1088,7 @@ void CBudgetManager::SetSynced(bool synced)
     }
 }
 
-void CBudgetManager::Sync(CNode* pfrom, const uint256& nProp, bool fPartial)
+void CBudgetManager::Sync(CNode* pfrom, const uint256& nProp, bool fPartial, const CBudgetVoteSyncDigest* pdigest)
 {
     LOCK(cs);
 
@@ -1232,6 +1099,7 @@ void CBudgetManager::Sync(CNode* pfrom, const uint256& nProp, bool fPartial)
 
         This code checks each of the hash maps for all known budget proposals and finalized budget proposals, then checks them against the
         budget object to see if they're OK. If all checks pass, we'll send it to the peer.
+        Given the peer's digest, the items it has are left out, and so are their votes in the buckets that match.
 
     */
 
@@ -1241,9 +1109,16 @@ void CBudgetManager::Sync(CNode* pfrom, const uint256& nProp, bool fPartial)
     for (auto& it: mapSeenMasternodeBudgetProposals) {
         CBudgetProposal* pbudgetProposal = FindProposal(it.first);
         if (pbudgetProposal && pbudgetProposal->IsValid() && (nProp.IsNull() || it.first == nProp)) {
-            pfrom->PushInventory(CInv(MSG_BUDGET_PROPOSAL, it.second.GetHash()));
-            nInvCount++;
-            pbudgetProposal->SyncVotes(pfrom, fPartial, nInvCount);
+            const std::vector<uint64_t>* pvPeerBuckets = nullptr;
+            if (pdigest) {
+                auto itDigest = pdigest->mapBuckets.find(it.first);
+                if (itDigest != pdigest->mapBuckets.end()) pvPeerBuckets = &itDigest->second;
+            }
+            if (!pvPeerBuckets) {
+                pfrom->PushInventory(CInv(MSG_BUDGET_PROPOSAL, it.second.GetHash()));
+                nInvCount++;
+            }
+            pbudgetProposal->SyncVotes(pfrom, fPartial, nInvCount, pdigest, pvPeerBuckets);
         }
     }
     g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_BUDGET_PROP, nInvCount));
@@ -1254,15 +1129,43 @@ void CBudgetManager::Sync(CNode* pfrom, const uint256& nProp, bool fPartial)
     for (auto& it: mapSeenFinalizedBudgets) {
         CFinalizedBudget* pfinalizedBudget = FindFinalizedBudget(it.first);
         if (pfinalizedBudget && pfinalizedBudget->IsValid() && (nProp.IsNull() || it.first == nProp)) {
-            pfrom->PushInventory(CInv(MSG_BUDGET_FINALIZED, it.second.GetHash()));
-            nInvCount++;
-            pfinalizedBudget->SyncVotes(pfrom, fPartial, nInvCount);
+            const std::vector<uint64_t>* pvPeerBuckets = nullptr;
+            if (pdigest) {
+                auto itDigest = pdigest->mapBuckets.find(it.first);
+                if (itDigest != pdigest->mapBuckets.end()) pvPeerBuckets = &itDigest->second;
+            }
+            if (!pvPeerBuckets) {
+                pfrom->PushInventory(CInv(MSG_BUDGET_FINALIZED, it.second.GetHash()));
+                nInvCount++;
+            }
+            pfinalizedBudget->SyncVotes(pfrom, fPartial, nInvCount, pdigest, pvPeerBuckets);
         }
     }
     g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_BUDGET_FIN, nInvCount));
     LogPrint(BCLog::MNBUDGET, "%s: sent %d items\n", __func__, nInvCount);
 }
 
+void CBudgetManager::RequestSync(CNode* pnode)
+{
+    CNetMsgMaker msgMaker(pnode->GetSendVersion());
+    uint256 n;
+    if (pnode->nVersion < BUDGETVOTESYNCDIFF_VERSION) {
+        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, n));
+        return;
+    }
+
+    CBudgetVoteSyncDigest digest;
+    digest.nSalt = GetRand(std::numeric_limits<uint64_t>::max());
+    {
+        LOCK(cs);
+        for (const auto& it: mapProposals)
+            digest.mapBuckets.emplace(it.first, it.second.GetVoteSyncBuckets(digest));
+        for (const auto& it: mapFinalizedBudgets)
+            digest.mapBuckets.emplace(it.first, it.second.GetVoteSyncBuckets(digest));
+    }
+    g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNCDIFF, n, digest));
+}
+
 bool CBudgetManager::UpdateProposal(const CBudgetVote& vote, CNode* pfrom, std::string& strError)
 {
     LOCK(cs);
@@ -1327,6 +1230,8 @@ CBudgetProposal::CBudgetProposal()
     nTime = 0;
     fValid = true;
     strInvalid = "";
+    nCleanListVersion = 0;
+    nYeas = nNays = nAbstains = 0;
 }
 
 CBudgetProposal::CBudgetProposal(std::string strProposalNameIn, std::string strURLIn, int nBlockStartIn, int nBlockEndIn, CScript addressIn, CAmount nAmountIn, uint256 nFeeTXHashIn)
@@ -1340,6 +1245,8 @@ CBudgetProposal::CBudgetProposal(std::string strProposalNameIn, std::string strU
     nFeeTXHash = nFeeTXHashIn;
     fValid = true;
     strInvalid = "";
+    nCleanListVersion = 0;
+    nYeas = nNays = nAbstains = 0;
 }
 
 CBudgetProposal::CBudgetProposal(const CBudgetProposal& other)
@@ -1353,22 +1260,45 @@ CBudgetProposal::CBudgetProposal(const CBudgetProposal& other)
     nTime = other.nTime;
     nFeeTXHash = other.nFeeTXHash;
     mapVotes = other.mapVotes;
+    nYeas = other.nYeas;
+    nNays = other.nNays;
+    nAbstains = other.nAbstains;
     fValid = true;
     strInvalid = "";
+    nCleanListVersion = other.nCleanListVersion;
 }
 
-void CBudgetProposal::SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const
+void CBudgetProposal::SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount, const CBudgetVoteSyncDigest* pdigest, const std::vector<uint64_t>* pvPeerBuckets) const
 {
     LOCK(cs);
+    std::vector<uint64_t> vBuckets;
+    if (pdigest && pvPeerBuckets) vBuckets = GetVoteSyncBuckets(*pdigest);
     for (const auto& it: mapVotes) {
         const CBudgetVote& vote = it.second;
         if (vote.IsValid() && (!fPartial || !vote.IsSynced())) {
-            pfrom->PushInventory(CInv(MSG_BUDGET_VOTE, vote.GetHash()));
+            const uint256& nHash = vote.GetHash();
+            if (!vBuckets.empty()) {
+                unsigned int nBucket = CBudgetVoteSyncDigest::GetBucket(pdigest->GetShortId(nHash));
+                if (vBuckets[nBucket] == (*pvPeerBuckets)[nBucket]) continue;
+            }
+            pfrom->PushInventory(CInv(MSG_BUDGET_VOTE, nHash));
             nInvCount++;
         }
     }
 }
 
+std::vector<uint64_t> CBudgetProposal::GetVoteSyncBuckets(const CBudgetVoteSyncDigest& digest) const
+{
+    LOCK(cs);
+    std::vector<uint64_t> vBuckets(BUDGET_VOTE_SYNC_BUCKETS, 0);
+    for (const auto& it: mapVotes) {
+        if (!it.second.IsValid()) continue;
+        uint64_t nShortId = digest.GetShortId(it.second.GetHash());
+        vBuckets[CBudgetVoteSyncDigest::GetBucket(nShortId)] ^= nShortId;
+    }
+    return vBuckets;
+}
+
 bool CBudgetProposal::UpdateValid(int nCurrentHeight, bool fCheckCollateral)
 {
     fValid = false;
@@ -1503,7 +1433,10 @@ bool CBudgetProposal::AddOrUpdateVote(const CBudgetVote& vote, std::string& strE
         return false;
     }
 
+    if (mapVotes.count(hash))
+        CountVote(mapVotes[hash], -1);
     mapVotes[hash] = vote;
+    CountVote(vote, 1);
     LogPrint(BCLog::MNBUDGET, "%s: %s %s\n", __func__, strAction.c_str(), vote.GetHash().ToString().c_str());
 
     return true;
@@ -1535,12 +1468,20 @@ void CBudgetProposal::SetSynced(bool synced)
 // If masternode voted for a proposal, but is now invalid -- remove the vote
 void CBudgetProposal::CleanAndRemove()
 {
-    std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin();
+    LOCK(cs);
 
-    while (it != mapVotes.end()) {
-        CMasternode* pmn = mnodeman.Find((*it).second.GetVin());
-        (*it).second.SetValid(pmn != nullptr);
-        ++it;
+    // votes only change validity with the masternode list
+    uint64_t nListVersion = mnodeman.GetListVersion();
+    if (nListVersion == nCleanListVersion) return;
+    nCleanListVersion = nListVersion;
+
+    for (auto& it : mapVotes) {
+        CBudgetVote& vote = it.second;
+        bool fValidVote = (mnodeman.Find(vote.GetVin()) != nullptr);
+        if (fValidVote == vote.IsValid()) continue;
+        CountVote(vote, -1);
+        vote.SetValid(fValidVote);
+        CountVote(vote, 1);
     }
 }
 
@@ -1557,13 +1498,30 @@ double CBudgetProposal::GetRatio() const
 int CBudgetProposal::GetVoteCount(CBudgetVote::VoteDirection vd) const
 {
     LOCK(cs);
-    int ret = 0;
-    for (const auto& it : mapVotes) {
-        const CBudgetVote& vote = it.second;
-        if (vote.GetDirection() == vd && vote.IsValid())
-            ret++;
+    switch (vd) {
+    case CBudgetVote::VOTE_YES: return nYeas;
+    case CBudgetVote::VOTE_NO: return nNays;
+    case CBudgetVote::VOTE_ABSTAIN: return nAbstains;
     }
-    return ret;
+    return 0;
+}
+
+void CBudgetProposal::CountVote(const CBudgetVote& vote, int nDelta)
+{
+    if (!vote.IsValid()) return;
+    switch (vote.GetDirection()) {
+    case CBudgetVote::VOTE_YES: nYeas += nDelta; break;
+    case CBudgetVote::VOTE_NO: nNays += nDelta; break;
+    case CBudgetVote::VOTE_ABSTAIN: nAbstains += nDelta; break;
+    }
+}
+
+void CBudgetProposal::RecountVotes()
+{
+    LOCK(cs);
+    nYeas = nNays = nAbstains = 0;
+    for (const auto& it : mapVotes)
+        CountVote(it.second, 1);
 }
 
 int CBudgetProposal::GetBlockStartCycle() const
@@ -1700,6 +1658,7 @@ CFinalizedBudget::CFinalizedBudget() :
         fAutoChecked(false),
         fValid(true),
         strInvalid(),
+        nCleanListVersion(0),
         mapVotes(),
         strBudgetName(""),
         nBlockStart(0),
@@ -1712,6 +1671,7 @@ CFinalizedBudget::CFinalizedBudget(const CFinalizedBudget& other) :
         fAutoChecked(false),
         fValid(true),
         strInvalid(),
+        nCleanListVersion(other.nCleanListVersion),
         mapVotes(other.mapVotes),
         strBudgetName(other.strBudgetName),
         nBlockStart(other.nBlockStart),
@@ -1885,12 +1845,16 @@ void CFinalizedBudget::CheckAndVote()
 // Remove votes from masternodes which are not valid/existent anymore
 void CFinalizedBudget::CleanAndRemove()
 {
-    std::map<uint256, CFinalizedBudgetVote>::iterator it = mapVotes.begin();
+    LOCK(cs);
 
-    while (it != mapVotes.end()) {
-        CMasternode* pmn = mnodeman.Find((*it).second.GetVin());
-        (*it).second.SetValid(pmn != nullptr);
-        ++it;
+    // votes only change validity with the masternode list
+    uint64_t nListVersion = mnodeman.GetListVersion();
+    if (nListVersion == nCleanListVersion) return;
+    nCleanListVersion = nListVersion;
+
+    for (auto& it : mapVotes) {
+        CMasternode* pmn = mnodeman.Find(it.second.GetVin());
+        it.second.SetValid(pmn != nullptr);
     }
 }
 
@@ -1960,18 +1924,37 @@ std::string CFinalizedBudget::GetStatus() const
     return retBadHashes + retBadPayeeOrAmount;
 }
 
-void CFinalizedBudget::SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const
+void CFinalizedBudget::SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount, const CBudgetVoteSyncDigest* pdigest, const std::vector<uint64_t>* pvPeerBuckets) const
 {
     LOCK(cs);
+    std::vector<uint64_t> vBuckets;
+    if (pdigest && pvPeerBuckets) vBuckets = GetVoteSyncBuckets(*pdigest);
     for (const auto& it: mapVotes) {
         const CFinalizedBudgetVote& vote = it.second;
         if (vote.IsValid() && (!fPartial || !vote.IsSynced())) {
-            pfrom->PushInventory(CInv(MSG_BUDGET_FINALIZED_VOTE, vote.GetHash()));
+            const uint256& nHash = vote.GetHash();
+            if (!vBuckets.empty()) {
+                unsigned int nBucket = CBudgetVoteSyncDigest::GetBucket(pdigest->GetShortId(nHash));
+                if (vBuckets[nBucket] == (*pvPeerBuckets)[nBucket]) continue;
+            }
+            pfrom->PushInventory(CInv(MSG_BUDGET_FINALIZED_VOTE, nHash));
             nInvCount++;
         }
     }
 }
 
+std::vector<uint64_t> CFinalizedBudget::GetVoteSyncBuckets(const CBudgetVoteSyncDigest& digest) const
+{
+    LOCK(cs);
+    std::vector<uint64_t> vBuckets(BUDGET_VOTE_SYNC_BUCKETS, 0);
+    for (const auto& it: mapVotes) {
+        if (!it.second.IsValid()) continue;
+        uint64_t nShortId = digest.GetShortId(it.second.GetHash());
+        vBuckets[CBudgetVoteSyncDigest::GetBucket(nShortId)] ^= nShortId;
+    }
+    return vBuckets;
+}
+
 bool CFinalizedBudget::UpdateValid(int nCurrentHeight, bool fCheckCollateral)
 {
     fValid = false;
@@ -7,11 +7,14 @@
 #define MASTERNODE_BUDGET_H
 
 #include "base58.h"
+#include "flat-database.h"
+#include "hash.h"
 #include "init.h"
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
 #include "net.h"
+#include "streams.h"
 #include "sync.h"
 #include "util.h"
 
@@ -39,6 +42,7 @@ static const CAmount PROPOSAL_FEE_TX = (50 * COIN);
 static const CAmount BUDGET_FEE_TX_OLD = (50 * COIN);
 static const CAmount BUDGET_FEE_TX = (5 * COIN);
 static const int64_t BUDGET_VOTE_UPDATE_MIN = 60 * 60;
+static const unsigned int BUDGET_VOTE_SYNC_BUCKETS = 16;
 static std::map<uint256, int> mapPayment_History;
 
 extern std::vector<CBudgetProposalBroadcast> vecImmatureBudgetProposals;
@@ -50,6 +54,30 @@ void DumpBudgets();
 //Check the collateral transaction for the budget proposal/finalized budget
 bool IsBudgetCollateralValid(const uint256& nTxCollateralHash, const uint256& nExpectedHash, std::string& strError, int64_t& nTime, int& nConf, bool fBudgetFinalization=false);
 
+/** Digest of the votes we have, sent with mnvsdiff so a peer only syncs what we are missing.
+ *  The valid votes of each proposal or finalized budget are spread over BUDGET_VOTE_SYNC_BUCKETS
+ *  buckets by their salted short id, and each bucket is summarized by the xor of its ids:
+ *  only the votes of the buckets that differ are sent.
+ */
+class CBudgetVoteSyncDigest
+{
+public:
+    uint64_t nSalt{0};
+    std::map<uint256, std::vector<uint64_t> > mapBuckets;
+
+    uint64_t GetShortId(const uint256& voteHash) const { return SipHashUint256(nSalt, 0, voteHash); }
+    static unsigned int GetBucket(uint64_t nShortId) { return nShortId % BUDGET_VOTE_SYNC_BUCKETS; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nSalt);
+        READWRITE(mapBuckets);
+    }
+};
+
 //
 // CBudgetVote - Allow a masternode node to vote and broadcast throughout the network
 //
@@ -180,30 +208,6 @@ public:
     }
 };
 
-/** Save Budget Manager (budget.dat)
- */
-class CBudgetDB
-{
-private:
-    fs::path pathDB;
-    std::string strMagicMessage;
-
-public:
-    enum ReadResult {
-        Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
-        IncorrectFormat
-    };
-
-    CBudgetDB();
-    bool Write(const CBudgetManager& objToSave);
-    ReadResult Read(CBudgetManager& objToLoad, bool fDryRun = false);
-};
-
 
 //
 // Budget Manager : Contains all proposals for the budget
@@ -271,7 +275,10 @@ public:
 
     void ResetSync() { SetSynced(false); }
     void MarkSynced() { SetSynced(true); }
-    void Sync(CNode* node, const uint256& nProp, bool fPartial = false);
+    // with pdigest, only the items and votes missing from the peer's digest are sent
+    void Sync(CNode* node, const uint256& nProp, bool fPartial = false, const CBudgetVoteSyncDigest* pdigest = nullptr);
+    // ask a peer for all proposals, budgets and votes, with a digest of ours if it understands mnvsdiff
+    void RequestSync(CNode* pnode);
     void SetBestHeight(int height) { nBestHeight.store(height, std::memory_order_release); };
     int GetBestHeight() const { return nBestHeight.load(std::memory_order_acquire); }
 
@@ -319,6 +326,7 @@ public:
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
+        LOCK(cs);
         READWRITE(mapSeenMasternodeBudgetProposals);
         READWRITE(mapSeenMasternodeBudgetVotes);
         READWRITE(mapSeenFinalizedBudgets);
@@ -330,6 +338,14 @@ public:
     }
 };
 
+/** Save Budget Manager (budget.dat)
+ */
+class CBudgetDB : public CFlatDB<CBudgetManager>
+{
+public:
+    CBudgetDB() : CFlatDB<CBudgetManager>("budget.dat", "MasternodeBudget", BCLog::MNBUDGET) {}
+};
+
 
 class CTxBudgetPayment
 {
@@ -373,6 +389,7 @@ private:
     bool fAutoChecked; //If it matches what we see, we'll auto vote for it (masternode only)
     bool fValid;
     std::string strInvalid;
+    uint64_t nCleanListVersion; // Masternode list version the votes were last checked against
 
 protected:
     std::map<uint256, CFinalizedBudgetVote> mapVotes;
@@ -392,8 +409,9 @@ public:
     UniValue GetVotesObject() const;
     void SetSynced(bool synced);    // sets fSynced on votes (true only if valid)
 
-    // sync budget votes with a node
-    void SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const;
+    // sync budget votes with a node, leaving out the buckets matching pvPeerBuckets
+    void SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount, const CBudgetVoteSyncDigest* pdigest = nullptr, const std::vector<uint64_t>* pvPeerBuckets = nullptr) const;
+    std::vector<uint64_t> GetVoteSyncBuckets(const CBudgetVoteSyncDigest& digest) const;
 
     // sets fValid and strInvalid, returns fValid
     bool UpdateValid(int nHeight, bool fCheckCollateral = true);
@@ -504,9 +522,18 @@ private:
     CAmount nAlloted;
     bool fValid;
     std::string strInvalid;
+    uint64_t nCleanListVersion; // Masternode list version the votes were last checked against
 
 protected:
     std::map<uint256, CBudgetVote> mapVotes;
+    // running count of the valid votes, by direction
+    int nYeas;
+    int nNays;
+    int nAbstains;
+
+    // add (nDelta 1) or take back (nDelta -1) a vote in the running counts, if it is valid
+    void CountVote(const CBudgetVote& vote, int nDelta);
+    void RecountVotes();
     std::string strProposalName;
     std::string strURL;
     int nBlockStart;
@@ -526,8 +553,9 @@ public:
     UniValue GetVotesArray() const;
     void SetSynced(bool synced);    // sets fSynced on votes (true only if valid)
 
-    // sync proposal votes with a node
-    void SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const;
+    // sync proposal votes with a node, leaving out the buckets matching pvPeerBuckets
+    void SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount, const CBudgetVoteSyncDigest* pdigest = nullptr, const std::vector<uint64_t>* pvPeerBuckets = nullptr) const;
+    std::vector<uint64_t> GetVoteSyncBuckets(const CBudgetVoteSyncDigest& digest) const;
 
     // sets fValid and strInvalid, returns fValid
     bool UpdateValid(int nHeight, bool fCheckCollateral = true);
@@ -588,6 +616,8 @@ public:
 
         //for saving to the serialized db
         READWRITE(mapVotes);
+        if (ser_action.ForRead())
+            RecountVotes();
     }
 
     // compare proposals by proposal hash
@@ -623,6 +653,9 @@ public:
         swap(first.nTime, second.nTime);
         swap(first.nFeeTXHash, second.nFeeTXHash);
         first.mapVotes.swap(second.mapVotes);
+        swap(first.nYeas, second.nYeas);
+        swap(first.nNays, second.nNays);
+        swap(first.nAbstains, second.nAbstains);
     }
 
     CBudgetProposalBroadcast& operator=(CBudgetProposalBroadcast from)
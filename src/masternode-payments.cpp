@@ -24,129 +24,6 @@ RecursiveMutex cs_vecPayments;
 RecursiveMutex cs_mapMasternodeBlocks;
 RecursiveMutex cs_mapMasternodePayeeVotes;
 
-//
-// CMasternodePaymentDB
-//
-
-CMasternodePaymentDB::CMasternodePaymentDB()
-{
-    pathDB = GetDataDir() / "mnpayments.dat";
-    strMagicMessage = "MasternodePayments";
-}
-
-bool CMasternodePaymentDB::Write(const CMasternodePayments& objToSave)
-{
-    int64_t nStart = GetTimeMillis();
-
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-    ssObj << strMagicMessage;                   // masternode cache file specific magic message
-    ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-    ssObj << objToSave;
-    uint256 hash = Hash(ssObj.begin(), ssObj.end());
-    ssObj << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathDB.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssObj;
-    } catch (const std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
-    }
-    fileout.fclose();
-
-    LogPrint(BCLog::MASTERNODE,"Written info to mnpayments.dat  %dms\n", GetTimeMillis() - nStart);
-
-    return true;
-}
-
-CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments& objToLoad, bool fDryRun)
-{
-    int64_t nStart = GetTimeMillis();
-    // open input file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "rb");
-    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        error("%s : Failed to open file %s", __func__, pathDB.string());
-        return FileError;
-    }
-
-    // use file size to size memory buffer
-    int fileSize = fs::file_size(pathDB);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
-
-    // read data and checksum from file
-    try {
-        filein.read((char*)&vchData[0], dataSize);
-        filein >> hashIn;
-    } catch (const std::exception& e) {
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return HashReadError;
-    }
-    filein.fclose();
-
-    CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
-    }
-
-    unsigned char pchMsgTmp[4];
-    std::string strMagicMessageTmp;
-    try {
-        // de-serialize file header (masternode cache file specific magic message) and ..
-        ssObj >> strMagicMessageTmp;
-
-        // ... verify the message matches predefined one
-        if (strMagicMessage != strMagicMessageTmp) {
-            error("%s : Invalid masternode payement cache magic message", __func__);
-            return IncorrectMagicMessage;
-        }
-
-
-        // de-serialize file header (network specific magic number) and ..
-        ssObj >> FLATDATA(pchMsgTmp);
-
-        // ... verify the network matches ours
-        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
-            error("%s : Invalid network magic number", __func__);
-            return IncorrectMagicNumber;
-        }
-
-        // de-serialize data into CMasternodePayments object
-        ssObj >> objToLoad;
-    } catch (const std::exception& e) {
-        objToLoad.Clear();
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return IncorrectFormat;
-    }
-
-    LogPrint(BCLog::MASTERNODE,"Loaded info from mnpayments.dat  %dms\n", GetTimeMillis() - nStart);
-    LogPrint(BCLog::MASTERNODE,"  %s\n", objToLoad.ToString());
-    if (!fDryRun) {
-        LogPrint(BCLog::MASTERNODE,"Masternode payments manager - cleaning....\n");
-        objToLoad.CleanPaymentList();
-        LogPrint(BCLog::MASTERNODE,"Masternode payments manager - result:\n");
-        LogPrint(BCLog::MASTERNODE,"  %s\n", objToLoad.ToString());
-    }
-
-    return Ok;
-}
-
 uint256 CMasternodePaymentWinner::GetHash() const
 {
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
@@ -202,29 +79,7 @@ void CMasternodePaymentWinner::Relay()
 
 void DumpMasternodePayments()
 {
-    int64_t nStart = GetTimeMillis();
-
-    CMasternodePaymentDB paymentdb;
-    CMasternodePayments tempPayments;
-
-    LogPrint(BCLog::MASTERNODE,"Verifying mnpayments.dat format...\n");
-    CMasternodePaymentDB::ReadResult readResult = paymentdb.Read(tempPayments, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CMasternodePaymentDB::FileError)
-        LogPrint(BCLog::MASTERNODE,"Missing budgets file - mnpayments.dat, will try to recreate\n");
-    else if (readResult != CMasternodePaymentDB::Ok) {
-        LogPrint(BCLog::MASTERNODE,"Error reading mnpayments.dat: ");
-        if (readResult == CMasternodePaymentDB::IncorrectFormat)
-            LogPrint(BCLog::MASTERNODE,"magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint(BCLog::MASTERNODE,"file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint(BCLog::MASTERNODE,"Writting info to mnpayments.dat...\n");
-    paymentdb.Write(masternodePayments);
-
-    LogPrint(BCLog::MASTERNODE,"Budget dump finished  %dms\n", GetTimeMillis() - nStart);
+    CMasternodePaymentDB().Dump(masternodePayments);
 }
 
 bool IsBlockValueValid(int nHeight, CAmount nExpectedValue, CAmount nMinted)
@@ -479,32 +334,49 @@ bool CMasternodePayments::GetBlockPayee(int nBlockHeight, CScript& payee)
     return false;
 }
 
+void CMasternodePayments::SchedulePayee(int nBlockHeight, bool fScheduled)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.find(nBlockHeight);
+    CScript payee;
+    if (it == mapMasternodeBlocks.end() || !(*it).second.GetPayee(payee)) return;
+
+    if (fScheduled) {
+        mapScheduledHeights[payee].insert(nBlockHeight);
+        return;
+    }
+
+    std::map<CScript, std::set<int> >::iterator it2 = mapScheduledHeights.find(payee);
+    if (it2 == mapScheduledHeights.end()) return;
+    (*it2).second.erase(nBlockHeight);
+    if ((*it2).second.empty()) mapScheduledHeights.erase(it2);
+}
+
+void CMasternodePayments::RebuildSchedule()
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    mapScheduledHeights.clear();
+    for (const auto& it : mapMasternodeBlocks)
+        SchedulePayee(it.first, true);
+}
+
 // Is this masternode scheduled to get paid soon?
 // -- Only look ahead up to 8 blocks to allow for propagation of the latest 2 winners
-bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
+bool CMasternodePayments::IsScheduled(const CScript& mnpayee, int nNotBlockHeight)
 {
-    LOCK(cs_mapMasternodeBlocks);
+    int nHeight = GetChainHeight();
+    if (nHeight < 0) return false;
 
-    int nHeight;
-    {
-        TRY_LOCK(cs_main, locked);
-        if (!locked || chainActive.Tip() == NULL) return false;
-        nHeight = chainActive.Tip()->nHeight;
-    }
+    LOCK(cs_mapMasternodeBlocks);
 
-    CScript mnpayee;
-    mnpayee = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
+    std::map<CScript, std::set<int> >::const_iterator it = mapScheduledHeights.find(mnpayee);
+    if (it == mapScheduledHeights.end()) return false;
 
-    CScript payee;
-    for (int64_t h = nHeight; h <= nHeight + 8; h++) {
-        if (h == nNotBlockHeight) continue;
-        if (mapMasternodeBlocks.count(h)) {
-            if (mapMasternodeBlocks[h].GetPayee(payee)) {
-                if (mnpayee == payee) {
-                    return true;
-                }
-            }
-        }
+    const std::set<int>& setHeights = (*it).second;
+    for (std::set<int>::const_iterator it2 = setHeights.lower_bound(nHeight); it2 != setHeights.end() && *it2 <= nHeight + 8; ++it2) {
+        if (*it2 != nNotBlockHeight) return true;
     }
 
     return false;
@@ -517,22 +389,23 @@ bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerI
         return false;
     }
 
-    {
-        LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
+    LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
 
-        if (mapMasternodePayeeVotes.count(winnerIn.GetHash())) {
-            return false;
-        }
+    if (mapMasternodePayeeVotes.count(winnerIn.GetHash())) {
+        return false;
+    }
 
-        mapMasternodePayeeVotes[winnerIn.GetHash()] = winnerIn;
+    mapMasternodePayeeVotes[winnerIn.GetHash()] = winnerIn;
 
-        if (!mapMasternodeBlocks.count(winnerIn.nBlockHeight)) {
-            CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
-            mapMasternodeBlocks[winnerIn.nBlockHeight] = blockPayees;
-        }
+    if (!mapMasternodeBlocks.count(winnerIn.nBlockHeight)) {
+        CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
+        mapMasternodeBlocks[winnerIn.nBlockHeight] = blockPayees;
     }
 
+    // the vote may change which payee leads the block
+    SchedulePayee(winnerIn.nBlockHeight, false);
     mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+    SchedulePayee(winnerIn.nBlockHeight, true);
 
     return true;
 }
@@ -644,6 +517,7 @@ void CMasternodePayments::CleanPaymentList()
             LogPrint(BCLog::MASTERNODE, "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.nBlockHeight);
             masternodeSync.mapSeenSyncMNW.erase((*it).first);
             mapMasternodePayeeVotes.erase(it++);
+            SchedulePayee(winner.nBlockHeight, false);
             mapMasternodeBlocks.erase(winner.nBlockHeight);
         } else {
             ++it;
@@ -725,6 +599,30 @@ bool CMasternodePayments::ProcessBlock(int nBlockHeight)
     return false;
 }
 
+void CMasternodePayments::QueueBlock(int nBlockHeight)
+{
+    LOCK(cs_queuedBlocks);
+    setQueuedBlocks.insert(nBlockHeight);
+}
+
+void CMasternodePayments::ProcessQueuedBlock()
+{
+    std::set<int> setBlocks;
+    {
+        LOCK(cs_queuedBlocks);
+        setBlocks.swap(setQueuedBlocks);
+    }
+
+    // in height order, as ProcessBlock never votes backwards
+    for (int nBlockHeight : setBlocks) {
+        // winner votes for the block are ranked against the one 100 blocks back, by us and by
+        // the peers relaying them; the scoring block of the next vote is known already too
+        mnodeman.PrepareRankTable(nBlockHeight - 100);
+        ProcessBlock(nBlockHeight);
+        mnodeman.PrepareRankTable(nBlockHeight + 1 - 100);
+    }
+}
+
 void CMasternodePayments::Sync(CNode* node, int nCountNeeded)
 {
     LOCK(cs_mapMasternodePayeeVotes);
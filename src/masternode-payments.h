@@ -6,9 +6,14 @@
 #ifndef MASTERNODE_PAYMENTS_H
 #define MASTERNODE_PAYMENTS_H
 
+#include "flat-database.h"
+#include "hash.h"
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
+#include "streams.h"
+
+#include <set>
 
 
 extern RecursiveMutex cs_vecPayments;
@@ -32,30 +37,6 @@ void FillBlockPayee(CMutableTransaction& txNew, const CBlockIndex* pindexPrev, b
 
 void DumpMasternodePayments();
 
-/** Save Masternode Payment Data (mnpayments.dat)
- */
-class CMasternodePaymentDB
-{
-private:
-    fs::path pathDB;
-    std::string strMagicMessage;
-
-public:
-    enum ReadResult {
-        Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
-        IncorrectFormat
-    };
-
-    CMasternodePaymentDB();
-    bool Write(const CMasternodePayments& objToSave);
-    ReadResult Read(CMasternodePayments& objToLoad, bool fDryRun = false);
-};
-
 class CMasternodePayee
 {
 public:
@@ -230,6 +211,15 @@ class CMasternodePayments
 {
 private:
     int nLastBlockHeight;
+    // blocks whose winner vote is still to be cast by the masternode thread
+    RecursiveMutex cs_queuedBlocks;
+    std::set<int> setQueuedBlocks;
+    // heights in mapMasternodeBlocks by the payee leading their votes
+    std::map<CScript, std::set<int> > mapScheduledHeights;
+
+    /// Add the leading payee of a block to (or remove it from) the schedule index
+    void SchedulePayee(int nBlockHeight, bool fScheduled);
+    void RebuildSchedule();
 
 public:
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
@@ -246,17 +236,23 @@ public:
         LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
         mapMasternodeBlocks.clear();
         mapMasternodePayeeVotes.clear();
+        mapScheduledHeights.clear();
     }
 
     bool AddWinningMasternode(CMasternodePaymentWinner& winner);
     bool ProcessBlock(int nBlockHeight);
+    /// Hand the winner vote for a block to the masternode thread, keeping it off the block processing path
+    void QueueBlock(int nBlockHeight);
+    /// Vote on the queued blocks in height order, warming the rank tables for each and the one after it
+    void ProcessQueuedBlock();
 
     void Sync(CNode* node, int nCountNeeded);
     void CleanPaymentList();
 
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight);
-    bool IsScheduled(CMasternode& mn, int nNotBlockHeight);
+    /// Whether the payee has a vote for one of the next 8 blocks, other than nNotBlockHeight
+    bool IsScheduled(const CScript& mnpayee, int nNotBlockHeight);
 
     bool CanVote(const COutPoint& outMasternode, int nBlockHeight)
     {
@@ -283,10 +279,21 @@ public:
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
+        LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
         READWRITE(mapMasternodePayeeVotes);
         READWRITE(mapMasternodeBlocks);
+        if (ser_action.ForRead())
+            RebuildSchedule();
     }
 };
 
+/** Save Masternode Payment Data (mnpayments.dat)
+ */
+class CMasternodePaymentDB : public CFlatDB<CMasternodePayments>
+{
+public:
+    CMasternodePaymentDB() : CFlatDB<CMasternodePayments>("mnpayments.dat", "MasternodePayments", BCLog::MASTERNODE) {}
+};
+
 
 #endif
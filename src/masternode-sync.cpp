@@ -119,6 +119,12 @@ void CMasternodeSync::AddedMasternodeList(const uint256& hash)
     }
 }
 
+void CMasternodeSync::ReceivedMasternodeListDiff()
+{
+    // an up to date list gets an empty diff, which still counts as progress
+    lastMasternodeList = GetTime();
+}
+
 void CMasternodeSync::AddedMasternodeWinner(const uint256& hash)
 {
     if (masternodePayments.mapMasternodePayeeVotes.count(hash)) {
@@ -148,6 +154,12 @@ void CMasternodeSync::AddedBudgetItem(const uint256& hash)
     }
 }
 
+void CMasternodeSync::ReceivedBudgetDiff()
+{
+    // a peer answering mnvsdiff leaves out what we have, so its counts are progress even when nothing else comes
+    lastBudgetItem = GetTime();
+}
+
 bool CMasternodeSync::IsBudgetPropEmpty()
 {
     return sumBudgetItemProp == 0 && countBudgetItemProp > 0;
@@ -230,11 +242,13 @@ void CMasternodeSync::ProcessMessage(CNode* pfrom, std::string& strCommand, CDat
             if (RequestedMasternodeAssets != MASTERNODE_SYNC_BUDGET) return;
             sumBudgetItemProp += nCount;
             countBudgetItemProp++;
+            if (pfrom->nVersion >= BUDGETVOTESYNCDIFF_VERSION) ReceivedBudgetDiff();
             break;
         case (MASTERNODE_SYNC_BUDGET_FIN):
             if (RequestedMasternodeAssets != MASTERNODE_SYNC_BUDGET) return;
             sumBudgetItemFin += nCount;
             countBudgetItemFin++;
+            if (pfrom->nVersion >= BUDGETVOTESYNCDIFF_VERSION) ReceivedBudgetDiff();
             break;
         }
 
@@ -302,8 +316,7 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool isRegTestNet)
             int nMnCount = mnodeman.CountEnabled();
 
             g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETMNWINNERS, nMnCount)); //sync payees
-            uint256 n;
-            g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, n)); //sync masternode votes
+            budget.RequestSync(pnode); //sync masternode votes
         } else {
             RequestedMasternodeAssets = MASTERNODE_SYNC_FINISHED;
         }
@@ -412,8 +425,7 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool isRegTestNet)
 
             if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3) return false;
 
-            uint256 n;
-            g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, n)); //sync masternode votes
+            budget.RequestSync(pnode); //sync masternode votes
             RequestedMasternodeAttempt++;
             return false;
         }
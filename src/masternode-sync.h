@@ -65,8 +65,10 @@ public:
     CMasternodeSync();
 
     void AddedMasternodeList(const uint256& hash);
+    void ReceivedMasternodeListDiff();
     void AddedMasternodeWinner(const uint256& hash);
     void AddedBudgetItem(const uint256& hash);
+    void ReceivedBudgetDiff();
     void GetNextAsset();
     std::string GetSyncStatus();
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
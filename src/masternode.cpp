@@ -120,6 +120,16 @@ std::string CMasternode::GetStrMessage() const
     );
 }
 
+uint256 CMasternode::GetListEntryHash() const
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << vin.prevout;
+    ss << sigTime;
+    ss << pubKeyCollateralAddress;
+    ss << lastPing.sigTime;
+    return ss.GetHash();
+}
+
 //
 // When a new masternode broadcast is sent, update our information
 //
@@ -156,8 +166,6 @@ uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight)
     }
 
     uint256 hash;
-    uint256 aux = vin.prevout.hash + vin.prevout.n;
-
     if (!GetBlockHash(hash, nBlockHeight)) {
         LogPrint(BCLog::MASTERNODE,"CalculateScore ERROR - nHeight %d - Returned 0\n", nBlockHeight);
         return UINT256_ZERO;
@@ -165,23 +173,26 @@ uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight)
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << hash;
-    uint256 hash2 = ss.GetHash();
+    return CalculateScore(hash, ss.GetHash());
+}
+
+uint256 CMasternode::CalculateScore(const uint256& hashBlock, const uint256& hashBlockDigest) const
+{
+    uint256 aux = vin.prevout.hash + vin.prevout.n;
 
     CHashWriter ss2(SER_GETHASH, PROTOCOL_VERSION);
-    ss2 << hash;
+    ss2 << hashBlock;
     ss2 << aux;
     uint256 hash3 = ss2.GetHash();
 
-    uint256 r = (hash3 > hash2 ? hash3 - hash2 : hash2 - hash3);
-
-    return r;
+    return (hash3 > hashBlockDigest ? hash3 - hashBlockDigest : hashBlockDigest - hash3);
 }
 
 void CMasternode::Check(bool forceCheck)
 {
     if (ShutdownRequested()) return;
 
-    // todo: add LOCK(cs) but be careful with the AcceptableInputs() below that requires cs_main.
+    // todo: add LOCK(cs) but be careful with GetCollateralState() below that tries cs_main.
 
     if (!forceCheck && (GetTime() - lastTimeChecked < MASTERNODE_CHECK_SECONDS)) return;
     lastTimeChecked = GetTime();
@@ -207,21 +218,13 @@ void CMasternode::Check(bool forceCheck)
     }
 
     if (!unitTest) {
-        CValidationState state;
-        CMutableTransaction tx = CMutableTransaction();
-        CScript dummyScript;
-        dummyScript << ToByteVector(pubKeyCollateralAddress) << OP_CHECKSIG;
-        CTxOut vout = CTxOut(9999.99 * COIN, dummyScript);
-        tx.vin.push_back(vin);
-        tx.vout.push_back(vout);
-        {
-            TRY_LOCK(cs_main, lockMain);
-            if (!lockMain) return;
-
-            if (!AcceptableInputs(mempool, state, CTransaction(tx), false, NULL)) {
-                activeState = MASTERNODE_VIN_SPENT;
-                return;
-            }
+        // the collateral amount was checked when the broadcast was accepted,
+        // after that only its spending can change
+        bool fUnspent;
+        if (!mnodeman.GetCollateralState(vin.prevout, fUnspent)) return;
+        if (!fUnspent) {
+            activeState = MASTERNODE_VIN_SPENT;
+            return;
         }
     }
 
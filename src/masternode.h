@@ -190,6 +190,8 @@ public:
     }
 
     uint256 CalculateScore(int mod = 1, int64_t nBlockHeight = 0);
+    /// Score for a block given its hash and the hash of that, which is the same for every Masternode
+    uint256 CalculateScore(const uint256& hashBlock, const uint256& hashBlockDigest) const;
 
     ADD_SERIALIZE_METHODS;
 
@@ -216,6 +218,9 @@ public:
 
     int64_t SecondsSincePayment();
 
+    /// Identifies the broadcast and last ping of this entry, used to compare masternode lists
+    uint256 GetListEntryHash() const;
+
     bool UpdateFromNewBroadcast(CMasternodeBroadcast& mnb);
 
     void Check(bool forceCheck = false);
@@ -7,6 +7,7 @@
 
 #include "addrman.h"
 #include "fs.h"
+#include "masternode-budget.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "masternode.h"
@@ -19,6 +20,9 @@
 
 #include <boost/thread/thread.hpp>
 
+#include <algorithm>
+#include <limits>
+
 #define MN_WINNER_MINIMUM_AGE 8000    // Age in seconds. This should be > MASTERNODE_REMOVAL_SECONDS to avoid misconfigured new nodes in the list.
 
 /** Masternode manager */
@@ -34,176 +38,16 @@ struct CompareLastPaid {
     }
 };
 
-struct CompareScoreTxIn {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-        const std::pair<int64_t, CTxIn>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
-struct CompareScoreMN {
-    bool operator()(const std::pair<int64_t, CMasternode>& t1,
-        const std::pair<int64_t, CMasternode>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
-//
-// CMasternodeDB
-//
-
-CMasternodeDB::CMasternodeDB()
-{
-    pathMN = GetDataDir() / "mncache.dat";
-    strMagicMessage = "MasternodeCache";
-}
-
-bool CMasternodeDB::Write(const CMasternodeMan& mnodemanToSave)
-{
-    int64_t nStart = GetTimeMillis();
-
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssMasternodes(SER_DISK, CLIENT_VERSION);
-    ssMasternodes << strMagicMessage;                   // masternode cache file specific magic message
-    ssMasternodes << FLATDATA(Params().MessageStart()); // network specific magic number
-    ssMasternodes << mnodemanToSave;
-    uint256 hash = Hash(ssMasternodes.begin(), ssMasternodes.end());
-    ssMasternodes << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathMN, "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathMN.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssMasternodes;
-    } catch (const std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
-    }
-    //    FileCommit(fileout);
-    fileout.fclose();
-
-    LogPrint(BCLog::MASTERNODE,"Written info to mncache.dat  %dms\n", GetTimeMillis() - nStart);
-    LogPrint(BCLog::MASTERNODE,"  %s\n", mnodemanToSave.ToString());
-
-    return true;
-}
-
-CMasternodeDB::ReadResult CMasternodeDB::Read(CMasternodeMan& mnodemanToLoad, bool fDryRun)
-{
-    int64_t nStart = GetTimeMillis();
-    // open input file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathMN, "rb");
-    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        error("%s : Failed to open file %s", __func__, pathMN.string());
-        return FileError;
-    }
-
-    // use file size to size memory buffer
-    int fileSize = fs::file_size(pathMN);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
-
-    // read data and checksum from file
-    try {
-        filein.read((char*)&vchData[0], dataSize);
-        filein >> hashIn;
-    } catch (const std::exception& e) {
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return HashReadError;
-    }
-    filein.fclose();
-
-    CDataStream ssMasternodes(vchData, SER_DISK, CLIENT_VERSION);
-
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssMasternodes.begin(), ssMasternodes.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
-    }
-
-    unsigned char pchMsgTmp[4];
-    std::string strMagicMessageTmp;
-    try {
-        // de-serialize file header (masternode cache file specific magic message) and ..
-
-        ssMasternodes >> strMagicMessageTmp;
-
-        // ... verify the message matches predefined one
-        if (strMagicMessage != strMagicMessageTmp) {
-            error("%s : Invalid masternode cache magic message", __func__);
-            return IncorrectMagicMessage;
-        }
-
-        // de-serialize file header (network specific magic number) and ..
-        ssMasternodes >> FLATDATA(pchMsgTmp);
-
-        // ... verify the network matches ours
-        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
-            error("%s : Invalid network magic number", __func__);
-            return IncorrectMagicNumber;
-        }
-        // de-serialize data into CMasternodeMan object
-        ssMasternodes >> mnodemanToLoad;
-    } catch (const std::exception& e) {
-        mnodemanToLoad.Clear();
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return IncorrectFormat;
-    }
-
-    LogPrint(BCLog::MASTERNODE,"Loaded info from mncache.dat  %dms\n", GetTimeMillis() - nStart);
-    LogPrint(BCLog::MASTERNODE,"  %s\n", mnodemanToLoad.ToString());
-    if (!fDryRun) {
-        LogPrint(BCLog::MASTERNODE,"Masternode manager - cleaning....\n");
-        mnodemanToLoad.CheckAndRemove(true);
-        LogPrint(BCLog::MASTERNODE,"Masternode manager - result:\n");
-        LogPrint(BCLog::MASTERNODE,"  %s\n", mnodemanToLoad.ToString());
-    }
-
-    return Ok;
-}
-
 void DumpMasternodes()
 {
-    int64_t nStart = GetTimeMillis();
-
-    CMasternodeDB mndb;
-    CMasternodeMan tempMnodeman;
-
-    LogPrint(BCLog::MASTERNODE,"Verifying mncache.dat format...\n");
-    CMasternodeDB::ReadResult readResult = mndb.Read(tempMnodeman, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CMasternodeDB::FileError)
-        LogPrint(BCLog::MASTERNODE,"Missing masternode cache file - mncache.dat, will try to recreate\n");
-    else if (readResult != CMasternodeDB::Ok) {
-        LogPrint(BCLog::MASTERNODE,"Error reading mncache.dat: ");
-        if (readResult == CMasternodeDB::IncorrectFormat)
-            LogPrint(BCLog::MASTERNODE,"magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint(BCLog::MASTERNODE,"file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint(BCLog::MASTERNODE,"Writting info to mncache.dat...\n");
-    mndb.Write(mnodeman);
-
-    LogPrint(BCLog::MASTERNODE,"Masternode dump finished  %dms\n", GetTimeMillis() - nStart);
+    CMasternodeDB().Dump(mnodeman);
 }
 
 CMasternodeMan::CMasternodeMan()
 {
     nDsqCount = 0;
+    // 0 is left for budget items whose votes were never checked against the list
+    nListVersion = 1;
 }
 
 bool CMasternodeMan::Add(CMasternode& mn)
@@ -217,6 +61,7 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if (pmn == NULL) {
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Adding new Masternode %s - %i now\n", mn.vin.prevout.hash.ToString(), size() + 1);
         vMasternodes.push_back(mn);
+        nListVersion++;
         return true;
     }
 
@@ -276,6 +121,11 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
                 }
             }
 
+            {
+                LOCK(cs_collaterals);
+                mapCollaterals.erase((*it).vin.prevout);
+            }
+
             // allow us to ask for this masternode again if we see another ping
             std::map<COutPoint, int64_t>::iterator it2 = mWeAskedForMasternodeListEntry.begin();
             while (it2 != mWeAskedForMasternodeListEntry.end()) {
@@ -287,6 +137,7 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             }
 
             it = vMasternodes.erase(it);
+            nListVersion++;
         } else {
             ++it;
         }
@@ -312,6 +163,16 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
         }
     }
 
+    // check who we asked for a Masternode list diff
+    std::map<NodeId, CMasternodeListDiffRequest>::iterator itDiff = mWeAskedForMasternodeListDiff.begin();
+    while (itDiff != mWeAskedForMasternodeListDiff.end()) {
+        if ((*itDiff).second.nExpires < GetTime()) {
+            mWeAskedForMasternodeListDiff.erase(itDiff++);
+        } else {
+            ++itDiff;
+        }
+    }
+
     // check which Masternodes we've asked for
     std::map<COutPoint, int64_t>::iterator it2 = mWeAskedForMasternodeListEntry.begin();
     while (it2 != mWeAskedForMasternodeListEntry.end()) {
@@ -348,12 +209,91 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     vMasternodes.clear();
+    nListVersion++;
+    lRankTables.clear();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
+    mWeAskedForMasternodeListDiff.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
     nDsqCount = 0;
+
+    LOCK(cs_collaterals);
+    mapCollaterals.clear();
+}
+
+bool CMasternodeMan::GetCollateralState(const COutPoint& outpoint, bool& fUnspent)
+{
+    bool fWatched = false;
+    {
+        LOCK(cs_collaterals);
+        std::map<COutPoint, bool>::const_iterator it = mapCollaterals.find(outpoint);
+        if (it != mapCollaterals.end()) {
+            fWatched = true;
+            fUnspent = it->second;
+        }
+    }
+
+    if (!fWatched) {
+        // start watching it, the chain events keep it up to date from now on
+        TRY_LOCK(cs_main, lockMain);
+        if (!lockMain) return false;
+        fUnspent = pcoinsTip->HaveCoin(outpoint);
+        LOCK(cs_collaterals);
+        mapCollaterals[outpoint] = fUnspent;
+    }
+
+    if (fUnspent && mempool.isSpent(outpoint))
+        fUnspent = false;
+    return true;
+}
+
+void CMasternodeMan::CollateralsBlockConnected(const CBlock& block)
+{
+    LOCK(cs_collaterals);
+    if (mapCollaterals.empty()) return;
+
+    for (const CTransaction& tx : block.vtx) {
+        if (!tx.IsCoinBase()) {
+            for (const CTxIn& txin : tx.vin) {
+                std::map<COutPoint, bool>::iterator it = mapCollaterals.find(txin.prevout);
+                if (it != mapCollaterals.end()) {
+                    LogPrint(BCLog::MASTERNODE, "%s : collateral %s spent by %s\n", __func__, txin.prevout.ToString(), tx.GetHash().ToString());
+                    it->second = false;
+                }
+            }
+        }
+        // a collateral created again after a reorg
+        const uint256& txid = tx.GetHash();
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            std::map<COutPoint, bool>::iterator it = mapCollaterals.find(COutPoint(txid, i));
+            if (it != mapCollaterals.end())
+                it->second = true;
+        }
+    }
+}
+
+void CMasternodeMan::CollateralsBlockDisconnected(const CBlock& block)
+{
+    LOCK(cs_collaterals);
+    if (mapCollaterals.empty()) return;
+
+    for (const CTransaction& tx : block.vtx) {
+        // the outputs of the block are gone, its inputs are unspent again
+        const uint256& txid = tx.GetHash();
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            std::map<COutPoint, bool>::iterator it = mapCollaterals.find(COutPoint(txid, i));
+            if (it != mapCollaterals.end())
+                it->second = false;
+        }
+        if (tx.IsCoinBase()) continue;
+        for (const CTxIn& txin : tx.vin) {
+            std::map<COutPoint, bool>::iterator it = mapCollaterals.find(txin.prevout);
+            if (it != mapCollaterals.end())
+                it->second = true;
+        }
+    }
 }
 
 int CMasternodeMan::stable_size ()
@@ -437,11 +377,39 @@ void CMasternodeMan::DsegUpdate(CNode* pnode)
         }
     }
 
-    g_connman->PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::GETMNLIST, CTxIn()));
     int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
+    if (pnode->nVersion >= MNLISTDIFF_VERSION) {
+        // describe our list in a few bytes per entry, the peer only sends what differs
+        uint64_t nSalt = GetRand(std::numeric_limits<uint64_t>::max());
+        std::vector<uint64_t> vShortIds;
+        vShortIds.reserve(vMasternodes.size());
+        for (const CMasternode& mn : vMasternodes)
+            vShortIds.push_back(SipHashUint256(nSalt, 0, mn.GetListEntryHash()));
+        g_connman->PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::GETMNLISTDIFF, nSalt, GetListHash(), vShortIds));
+        mWeAskedForMasternodeListDiff[pnode->GetId()] = CMasternodeListDiffRequest{nSalt, askAgain, -1};
+    } else {
+        g_connman->PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::GETMNLIST, CTxIn()));
+    }
     mWeAskedForMasternodeList[pnode->addr] = askAgain;
 }
 
+uint256 CMasternodeMan::GetListHash()
+{
+    LOCK(cs);
+
+    std::vector<std::pair<COutPoint, uint256> > vEntries;
+    for (CMasternode& mn : vMasternodes) {
+        if (mn.addr.IsRFC1918() || !mn.IsEnabled()) continue;
+        vEntries.push_back(std::make_pair(mn.vin.prevout, mn.GetListEntryHash()));
+    }
+    std::sort(vEntries.begin(), vEntries.end());
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    for (const std::pair<COutPoint, uint256>& entry : vEntries)
+        ss << entry.second;
+    return ss.GetHash();
+}
+
 CMasternode* CMasternodeMan::Find(const CScript& payee)
 {
     LOCK(cs);
@@ -467,6 +435,18 @@ CMasternode* CMasternodeMan::Find(const CTxIn& vin)
 }
 
 
+bool CMasternodeMan::GetMasternodePubKey(const CTxIn& vin, CPubKey& pubKeyMasternodeRet)
+{
+    LOCK(cs);
+
+    // the entry can be moved or erased as soon as cs is released
+    CMasternode* pmn = Find(vin);
+    if (!pmn)
+        return false;
+    pubKeyMasternodeRet = pmn->pubKeyMasternode;
+    return true;
+}
+
 CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 {
     LOCK(cs);
@@ -500,12 +480,13 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
         // //check protocol version
         if (mn.protocolVersion < ActiveProtocol()) continue;
 
-        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if (masternodePayments.IsScheduled(mn, nBlockHeight)) continue;
-
         //it's too new, wait for a cycle
         if (fFilterSigTime && mn.sigTime + (nMnCount * 2.6 * 60) > GetAdjustedTime()) continue;
 
+        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
+        const CScript& mnpayee = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
+        if (masternodePayments.IsScheduled(mnpayee, nBlockHeight)) continue;
+
         //make sure it has as many confirmations as there are masternodes
         if (pcoinsTip->GetCoinDepthAtHeight(mn.vin.prevout, nBlockHeight) < nMnCount) continue;
 
@@ -527,11 +508,14 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
     int nTenthNetwork = CountEnabled() / 10;
     int nCountTenth = 0;
     uint256 nHigh;
+    uint256 hashBlock;
+    if (!GetBlockHash(hashBlock, nBlockHeight - 100)) return NULL;
+    const CMasternodeRankTable& rankTable = GetRankTable(hashBlock);
     for (PAIRTYPE(int64_t, CTxIn) & s : vecMasternodeLastPaid) {
         CMasternode* pmn = Find(s.second);
         if (!pmn) break;
 
-        uint256 n = pmn->CalculateScore(1, nBlockHeight - 100);
+        const uint256& n = rankTable.vScores[pmn - &vMasternodes[0]];
         if (n > nHigh) {
             nHigh = n;
             pBestMasternode = pmn;
@@ -542,48 +526,126 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
     return pBestMasternode;
 }
 
+const CMasternodeRankTable& CMasternodeMan::GetRankTable(const uint256& hashBlock)
+{
+    AssertLockHeld(cs);
+
+    std::list<CMasternodeRankTable>::iterator it = lRankTables.begin();
+    while (it != lRankTables.end()) {
+        if ((*it).nListVersion != nListVersion) {
+            it = lRankTables.erase(it);
+        } else if ((*it).hashBlock == hashBlock) {
+            lRankTables.splice(lRankTables.begin(), lRankTables, it);
+            return lRankTables.front();
+        } else {
+            ++it;
+        }
+    }
+
+    // the hash of the block hash is the same in every score, take it once
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << hashBlock;
+    uint256 hashBlockDigest = ss.GetHash();
+
+    CMasternodeRankTable table;
+    table.hashBlock = hashBlock;
+    table.nListVersion = nListVersion;
+    table.vScores.reserve(vMasternodes.size());
+    table.vCompactScores.reserve(vMasternodes.size());
+    table.vOrder.reserve(vMasternodes.size());
+    for (const CMasternode& mn : vMasternodes) {
+        table.vOrder.push_back(table.vScores.size());
+        table.vScores.push_back(mn.CalculateScore(hashBlock, hashBlockDigest));
+        table.vCompactScores.push_back(table.vScores.back().GetCompact(false));
+    }
+    const std::vector<int64_t>& vCompactScores = table.vCompactScores;
+    std::sort(table.vOrder.begin(), table.vOrder.end(), [&vCompactScores](size_t a, size_t b) {
+        return vCompactScores[a] != vCompactScores[b] ? vCompactScores[a] > vCompactScores[b] : a < b;
+    });
+
+    lRankTables.push_front(std::move(table));
+    if (lRankTables.size() > MNRANK_TABLES_CACHED)
+        lRankTables.pop_back();
+    return lRankTables.front();
+}
+
+void CMasternodeMan::PrepareRankTable(int64_t nBlockHeight)
+{
+    uint256 hashBlock;
+    if (!GetBlockHash(hashBlock, nBlockHeight)) return;
+
+    LOCK(cs);
+    GetRankTable(hashBlock);
+}
+
+bool CMasternodeMan::GetTopScoreMasternode(int64_t nBlockHeight, CTxIn& vinRet)
+{
+    //make sure we know about this block
+    uint256 hashBlock;
+    if (!GetBlockHash(hashBlock, nBlockHeight)) return false;
+
+    LOCK(cs);
+    const CMasternodeRankTable& rankTable = GetRankTable(hashBlock);
+    if (rankTable.vOrder.empty()) return false;
+
+    // the compact scores keep the order of the full ones, so the best is among the leading ties
+    size_t nBest = rankTable.vOrder[0];
+    for (size_t i : rankTable.vOrder) {
+        if (rankTable.vCompactScores[i] != rankTable.vCompactScores[nBest]) break;
+        if (rankTable.vScores[i] > rankTable.vScores[nBest]) nBest = i;
+    }
+    if (rankTable.vScores[nBest] == UINT256_ZERO) return false;
+
+    vinRet = vMasternodes[nBest].vin;
+    return true;
+}
+
 CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol)
 {
-    int64_t score = 0;
-    CMasternode* winner = NULL;
+    //make sure we know about this block
+    uint256 hashBlock;
+    if (!GetBlockHash(hashBlock, nBlockHeight)) return NULL;
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
+    LOCK(cs);
+    const CMasternodeRankTable& rankTable = GetRankTable(hashBlock);
+
+    // the winner is the first eligible Masternode in score order
+    for (size_t i : rankTable.vOrder) {
+        if (rankTable.vCompactScores[i] <= 0) break;
+
+        CMasternode& mn = vMasternodes[i];
         mn.Check();
         if (mn.protocolVersion < minProtocol || !mn.IsEnabled()) continue;
 
-        // calculate the score for each Masternode
-        uint256 n = mn.CalculateScore(mod, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        // determine the winner
-        if (n2 > score) {
-            score = n2;
-            winner = &mn;
-        }
+        return &mn;
     }
 
-    return winner;
+    return NULL;
 }
 
 int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CTxIn> > vecMasternodeScores;
     int64_t nMasternode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nMasternode_Age = 0;
+    bool fCheckAge = sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT);
 
     //make sure we know about this block
-    uint256 hash;
-    if (!GetBlockHash(hash, nBlockHeight)) return -1;
+    uint256 hashBlock;
+    if (!GetBlockHash(hashBlock, nBlockHeight)) return -1;
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
+    LOCK(cs);
+    const CMasternodeRankTable& rankTable = GetRankTable(hashBlock);
+
+    // walk the list in score order, counting the eligible Masternodes up to the one asked for
+    int rank = 0;
+    for (size_t i : rankTable.vOrder) {
+        CMasternode& mn = vMasternodes[i];
         if (mn.protocolVersion < minProtocol) {
             LogPrint(BCLog::MASTERNODE,"Skipping Masternode with obsolete version %d\n", mn.protocolVersion);
             continue;                                                       // Skip obsolete versions
         }
 
-        if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)) {
+        if (fCheckAge) {
             nMasternode_Age = GetAdjustedTime() - mn.sigTime;
             if ((nMasternode_Age) < nMasternode_Min_Age) {
                 LogPrint(BCLog::MASTERNODE,"Skipping just activated Masternode. Age: %ld\n", nMasternode_Age);
@@ -594,18 +656,9 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
             mn.Check();
             if (!mn.IsEnabled()) continue;
         }
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(n2, mn.vin));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
 
-    int rank = 0;
-    for (PAIRTYPE(int64_t, CTxIn) & s : vecMasternodeScores) {
         rank++;
-        if (s.second.prevout == vin.prevout) {
+        if (mn.vin.prevout == vin.prevout) {
             return rank;
         }
     }
@@ -615,39 +668,126 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
 
 std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int64_t nBlockHeight, int minProtocol)
 {
-    std::vector<std::pair<int64_t, CMasternode> > vecMasternodeScores;
     std::vector<std::pair<int, CMasternode> > vecMasternodeRanks;
 
     //make sure we know about this block
-    uint256 hash;
-    if (!GetBlockHash(hash, nBlockHeight)) return vecMasternodeRanks;
+    uint256 hashBlock;
+    if (!GetBlockHash(hashBlock, nBlockHeight)) return vecMasternodeRanks;
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
+    LOCK(cs);
+    const CMasternodeRankTable& rankTable = GetRankTable(hashBlock);
+
+    // enabled Masternodes by score, then the disabled ones
+    std::vector<size_t> vDisabled;
+    int rank = 0;
+    for (size_t i : rankTable.vOrder) {
+        CMasternode& mn = vMasternodes[i];
         mn.Check();
 
         if (mn.protocolVersion < minProtocol) continue;
 
         if (!mn.IsEnabled()) {
-            vecMasternodeScores.push_back(std::make_pair(9999, mn));
+            vDisabled.push_back(i);
             continue;
         }
 
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
+        vecMasternodeRanks.push_back(std::make_pair(++rank, mn));
+    }
+    for (size_t i : vDisabled)
+        vecMasternodeRanks.push_back(std::make_pair(++rank, vMasternodes[i]));
 
-        vecMasternodeScores.push_back(std::make_pair(n2, mn));
+    return vecMasternodeRanks;
+}
+
+bool CMasternodeMan::AllowListRequest(CNode* pfrom)
+{
+    //local network
+    bool isLocal = (pfrom->addr.IsRFC1918() || pfrom->addr.IsLocal());
+
+    if (!isLocal && Params().NetworkID() == CBaseChainParams::MAIN) {
+        std::map<CNetAddr, int64_t>::iterator i = mAskedUsForMasternodeList.find(pfrom->addr);
+        if (i != mAskedUsForMasternodeList.end()) {
+            int64_t t = (*i).second;
+            if (GetTime() < t) {
+                LogPrintf("CMasternodeMan::ProcessMessage() : dseg - peer already asked me for the list\n");
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), 34);
+                return false;
+            }
+        }
+        int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
+        mAskedUsForMasternodeList[pfrom->addr] = askAgain;
     }
+    return true;
+}
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+void CMasternodeMan::ProcessBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb)
+{
+    if (mapSeenMasternodeBroadcast.count(mnb.GetHash())) { //seen
+        masternodeSync.AddedMasternodeList(mnb.GetHash());
+        return;
+    }
+    mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
 
-    int rank = 0;
-    for (PAIRTYPE(int64_t, CMasternode) & s : vecMasternodeScores) {
-        rank++;
-        vecMasternodeRanks.push_back(std::make_pair(rank, s.second));
+    int nDoS = 0;
+    if (!mnb.CheckAndUpdate(nDoS)) {
+        if (nDoS > 0) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), nDoS);
+        }
+        //failed
+        return;
     }
 
-    return vecMasternodeRanks;
+    // make sure the vout that was signed is related to the transaction that spawned the Masternode
+    //  - this is expensive, so it's only done once per Masternode
+    if (!mnb.IsInputAssociatedWithPubkey()) {
+        LogPrintf("CMasternodeMan::ProcessMessage() : mnb - Got mismatched pubkey and vin\n");
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), 33);
+        return;
+    }
+
+    // make sure it's still unspent
+    //  - this is checked later by .check() in many places and by ThreadCheckObfuScationPool()
+    if (mnb.CheckInputsAndAdd(nDoS)) {
+        // use this as a peer
+        g_connman->AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2 * 60 * 60);
+        masternodeSync.AddedMasternodeList(mnb.GetHash());
+    } else {
+        LogPrint(BCLog::MASTERNODE,"mnb - Rejected Masternode entry %s\n", mnb.vin.prevout.hash.ToString());
+
+        if (nDoS > 0) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), nDoS);
+        }
+    }
+}
+
+void CMasternodeMan::ProcessPing(CNode* pfrom, CMasternodePing& mnp)
+{
+    LogPrint(BCLog::MNPING, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash.ToString());
+
+    if (mapSeenMasternodePing.count(mnp.GetHash())) return; //seen
+    mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+
+    int nDoS = 0;
+    if (mnp.CheckAndUpdate(nDoS)) return;
+
+    if (nDoS > 0) {
+        // if anything significant failed, mark that node
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), nDoS);
+    } else {
+        // if nothing significant failed, search existing Masternode list
+        CMasternode* pmn = Find(mnp.vin);
+        // if it's known, don't ask for the mnb, just return
+        if (pmn != NULL) return;
+    }
+
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.vin);
 }
 
 void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
@@ -660,74 +800,13 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
     if (strCommand == NetMsgType::MNBROADCAST) { //Masternode Broadcast
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
-
-        if (mapSeenMasternodeBroadcast.count(mnb.GetHash())) { //seen
-            masternodeSync.AddedMasternodeList(mnb.GetHash());
-            return;
-        }
-        mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
-
-        int nDoS = 0;
-        if (!mnb.CheckAndUpdate(nDoS)) {
-            if (nDoS > 0) {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), nDoS);
-            }
-            //failed
-            return;
-        }
-
-        // make sure the vout that was signed is related to the transaction that spawned the Masternode
-        //  - this is expensive, so it's only done once per Masternode
-        if (!mnb.IsInputAssociatedWithPubkey()) {
-            LogPrintf("CMasternodeMan::ProcessMessage() : mnb - Got mismatched pubkey and vin\n");
-            LOCK(cs_main);
-            Misbehaving(pfrom->GetId(), 33);
-            return;
-        }
-
-        // make sure it's still unspent
-        //  - this is checked later by .check() in many places and by ThreadCheckObfuScationPool()
-        if (mnb.CheckInputsAndAdd(nDoS)) {
-            // use this as a peer
-            g_connman->AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2 * 60 * 60);
-            masternodeSync.AddedMasternodeList(mnb.GetHash());
-        } else {
-            LogPrint(BCLog::MASTERNODE,"mnb - Rejected Masternode entry %s\n", mnb.vin.prevout.hash.ToString());
-
-            if (nDoS > 0) {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), nDoS);
-            }
-        }
+        ProcessBroadcast(pfrom, mnb);
     }
 
     else if (strCommand == NetMsgType::MNPING) { //Masternode Ping
         CMasternodePing mnp;
         vRecv >> mnp;
-
-        LogPrint(BCLog::MNPING, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash.ToString());
-
-        if (mapSeenMasternodePing.count(mnp.GetHash())) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
-
-        int nDoS = 0;
-        if (mnp.CheckAndUpdate(nDoS)) return;
-
-        if (nDoS > 0) {
-            // if anything significant failed, mark that node
-            LOCK(cs_main);
-            Misbehaving(pfrom->GetId(), nDoS);
-        } else {
-            // if nothing significant failed, search existing Masternode list
-            CMasternode* pmn = Find(mnp.vin);
-            // if it's known, don't ask for the mnb, just return
-            if (pmn != NULL) return;
-        }
-
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.vin);
+        ProcessPing(pfrom, mnp);
 
     } else if (strCommand == NetMsgType::GETMNLIST) { //Get Masternode list or specific entry
 
@@ -735,23 +814,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         vRecv >> vin;
 
         if (vin == CTxIn()) { //only should ask for this once
-            //local network
-            bool isLocal = (pfrom->addr.IsRFC1918() || pfrom->addr.IsLocal());
-
-            if (!isLocal && Params().NetworkID() == CBaseChainParams::MAIN) {
-                std::map<CNetAddr, int64_t>::iterator i = mAskedUsForMasternodeList.find(pfrom->addr);
-                if (i != mAskedUsForMasternodeList.end()) {
-                    int64_t t = (*i).second;
-                    if (GetTime() < t) {
-                        LogPrintf("CMasternodeMan::ProcessMessage() : dseg - peer already asked me for the list\n");
-                        LOCK(cs_main);
-                        Misbehaving(pfrom->GetId(), 34);
-                        return;
-                    }
-                }
-                int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
-                mAskedUsForMasternodeList[pfrom->addr] = askAgain;
-            }
+            if (!AllowListRequest(pfrom)) return;
         } //else, asking for a specific node which is ok
 
 
@@ -782,6 +845,99 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             g_connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, nInvCount));
             LogPrint(BCLog::MASTERNODE, "dseg - Sent %d Masternode entries to peer %i\n", nInvCount, pfrom->GetId());
         }
+
+    } else if (strCommand == NetMsgType::GETMNLISTDIFF) { //Get the differences with the peer's Masternode list
+        uint64_t nSalt;
+        uint256 hashList;
+        std::vector<uint64_t> vShortIds;
+        vRecv >> nSalt >> hashList >> vShortIds;
+
+        if (!AllowListRequest(pfrom)) return;
+
+        // entries the peer has but we don't relay are left in setTheirs
+        uint256 hashOurs = GetListHash();
+        std::vector<CMasternodeBroadcast> vBroadcasts;
+        std::vector<uint64_t> vRemoved;
+        if (hashList != hashOurs) {
+            std::set<uint64_t> setTheirs(vShortIds.begin(), vShortIds.end());
+            LOCK(cs);
+            for (CMasternode& mn : vMasternodes) {
+                if (mn.addr.IsRFC1918() || !mn.IsEnabled()) continue;
+                if (setTheirs.erase(SipHashUint256(nSalt, 0, mn.GetListEntryHash()))) continue;
+
+                CMasternodeBroadcast mnb = CMasternodeBroadcast(mn);
+                uint256 hash = mnb.GetHash();
+                if (!mapSeenMasternodeBroadcast.count(hash)) mapSeenMasternodeBroadcast.insert(std::make_pair(hash, mnb));
+                vBroadcasts.push_back(mnb);
+            }
+            vRemoved.assign(setTheirs.begin(), setTheirs.end());
+        }
+
+        if (vBroadcasts.size() > MNLISTDIFF_MAX_TOTAL)
+            vBroadcasts.resize(MNLISTDIFF_MAX_TOTAL);
+
+        // each message tells how many broadcasts are left from its own, so the requester knows the last one
+        CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+        size_t nSent = 0;
+        do {
+            size_t nChunk = std::min(vBroadcasts.size() - nSent, (size_t)MNLISTDIFF_MAX_BROADCASTS);
+            std::vector<CMasternodeBroadcast> vChunk(vBroadcasts.begin() + nSent, vBroadcasts.begin() + nSent + nChunk);
+            int nLeft = vBroadcasts.size() - nSent;
+            g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNLISTDIFF, hashOurs, nLeft, vChunk, nSent == 0 ? vRemoved : std::vector<uint64_t>()));
+            nSent += nChunk;
+        } while (nSent < vBroadcasts.size());
+        g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, (int)vBroadcasts.size()));
+        LogPrint(BCLog::MASTERNODE, "dsegdiff - Sent %d Masternode entries and %d unknown ids to peer %i\n", vBroadcasts.size(), vRemoved.size(), pfrom->GetId());
+
+    } else if (strCommand == NetMsgType::MNLISTDIFF) { //Differences with our Masternode list
+        uint256 hashList;
+        int nLeft;
+        std::vector<CMasternodeBroadcast> vBroadcasts;
+        std::vector<uint64_t> vRemoved;
+        vRecv >> hashList >> nLeft >> vBroadcasts >> vRemoved;
+
+        uint64_t nSalt;
+        {
+            LOCK(cs);
+            std::map<NodeId, CMasternodeListDiffRequest>::iterator it = mWeAskedForMasternodeListDiff.find(pfrom->GetId());
+            // the first message gives the total, the next ones must count down from it
+            bool fFirst = it != mWeAskedForMasternodeListDiff.end() && it->second.nRemaining < 0;
+            if (it == mWeAskedForMasternodeListDiff.end() || vBroadcasts.size() > MNLISTDIFF_MAX_BROADCASTS ||
+                    nLeft < (int)vBroadcasts.size() || nLeft > MNLISTDIFF_MAX_TOTAL ||
+                    (!fFirst && (nLeft != it->second.nRemaining || !vRemoved.empty()))) {
+                LogPrint(BCLog::MASTERNODE, "mnlistdiff - unrequested or malformed diff from peer %i\n", pfrom->GetId());
+                if (it != mWeAskedForMasternodeListDiff.end())
+                    mWeAskedForMasternodeListDiff.erase(it);
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), 20);
+                return;
+            }
+            nSalt = it->second.nSalt;
+            it->second.nRemaining = nLeft - vBroadcasts.size();
+            if (it->second.nRemaining == 0)
+                mWeAskedForMasternodeListDiff.erase(it);
+        }
+        masternodeSync.ReceivedMasternodeListDiff();
+
+        for (CMasternodeBroadcast& mnb : vBroadcasts) {
+            // a known broadcast is only sent again when its ping is newer than ours
+            if (mapSeenMasternodeBroadcast.count(mnb.GetHash()) && !mnb.lastPing.IsNull() && Find(mnb.vin) != NULL)
+                ProcessPing(pfrom, mnb.lastPing);
+            ProcessBroadcast(pfrom, mnb);
+        }
+
+        if (!vRemoved.empty()) {
+            // the peer doesn't relay these entries: check them again rather than taking its word
+            std::set<uint64_t> setRemoved(vRemoved.begin(), vRemoved.end());
+            LOCK(cs);
+            for (CMasternode& mn : vMasternodes) {
+                if (setRemoved.count(SipHashUint256(nSalt, 0, mn.GetListEntryHash())))
+                    mn.Check(true);
+            }
+        }
+
+        LogPrint(BCLog::MASTERNODE, "mnlistdiff - Got %d Masternode entries and %d unknown ids from peer %i, lists %s\n",
+            vBroadcasts.size(), vRemoved.size(), pfrom->GetId(), hashList == GetListHash() ? "match" : "differ");
     }
 }
 
@@ -793,7 +949,12 @@ void CMasternodeMan::Remove(CTxIn vin)
     while (it != vMasternodes.end()) {
         if ((*it).vin == vin) {
             LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing Masternode %s - %i now\n", (*it).vin.prevout.hash.ToString(), size() - 1);
+            {
+                LOCK(cs_collaterals);
+                mapCollaterals.erase((*it).vin.prevout);
+            }
             vMasternodes.erase(it);
+            nListVersion++;
             break;
         }
         ++it;
@@ -847,6 +1008,8 @@ void ThreadCheckMasternodes()
             boost::this_thread::interruption_point();
             // try to sync from all available nodes, one step at a time
             masternodeSync.Process();
+            // cast the winner vote queued by the last block connected
+            masternodePayments.ProcessQueuedBlock();
 
             if (masternodeSync.IsBlockchainSynced()) {
                 c++;
@@ -860,6 +1023,13 @@ void ThreadCheckMasternodes()
                     masternodePayments.CleanPaymentList();
                     CleanTransactionLocksList();
                 }
+
+                // keep the caches on disk recent, rather than only written at shutdown
+                if (c % MASTERNODES_DUMP_SECONDS == 0) {
+                    DumpMasternodes();
+                    DumpBudgets();
+                    DumpMasternodePayments();
+                }
             }
         }
     } catch (boost::thread_interrupted&) {
@@ -8,15 +8,23 @@
 
 #include "activemasternode.h"
 #include "base58.h"
+#include "flat-database.h"
+#include "hash.h"
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
 #include "net.h"
+#include "streams.h"
 #include "sync.h"
 #include "util.h"
 
+#include <list>
+
 #define MASTERNODES_DUMP_SECONDS (15 * 60)
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
+#define MNLISTDIFF_MAX_BROADCASTS 1000 // per mnlistdiff message
+#define MNLISTDIFF_MAX_TOTAL 50000 // per diff, over all its mnlistdiff messages
+#define MNRANK_TABLES_CACHED 16 // blocks whose Masternode scores are kept
 
 
 class CMasternodeMan;
@@ -28,28 +36,27 @@ extern std::string strMasterNodePrivKey;
 
 void DumpMasternodes();
 
-/** Access to the MN database (mncache.dat)
+/** Scores of the whole Masternode list for one block, computed together and kept until the list changes
  */
-class CMasternodeDB
-{
-private:
-    fs::path pathMN;
-    std::string strMagicMessage;
+struct CMasternodeRankTable {
+    uint256 hashBlock;
+    uint64_t nListVersion;
+    // by position in vMasternodes
+    std::vector<uint256> vScores;
+    std::vector<int64_t> vCompactScores;
+    // positions in vMasternodes, highest compact score first, ties in list order
+    std::vector<size_t> vOrder;
+};
 
-public:
-    enum ReadResult {
-        Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
-        IncorrectFormat
-    };
-
-    CMasternodeDB();
-    bool Write(const CMasternodeMan& mnodemanToSave);
-    ReadResult Read(CMasternodeMan& mnodemanToLoad, bool fDryRun = false);
+/** A Masternode list diff we asked a peer for
+ */
+struct CMasternodeListDiffRequest {
+    // salt of the short ids we sent
+    uint64_t nSalt;
+    // when the request expires
+    int64_t nExpires;
+    // broadcasts still to come, -1 until the first mnlistdiff message tells the total
+    int nRemaining;
 };
 
 class CMasternodeMan
@@ -69,6 +76,28 @@ private:
     std::map<CNetAddr, int64_t> mWeAskedForMasternodeList;
     // which Masternodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
+    // who we asked for a Masternode list diff, until its last mnlistdiff message arrives or it expires
+    std::map<NodeId, CMasternodeListDiffRequest> mWeAskedForMasternodeListDiff;
+
+    // critical section to protect the collateral watch set, taken after cs_main
+    mutable RecursiveMutex cs_collaterals;
+    // collaterals of the listed Masternodes and whether they are unspent in the active chain,
+    // filled from the coins view on first use then kept up to date as blocks are (dis)connected
+    std::map<COutPoint, bool> mapCollaterals;
+
+    // bumped whenever Masternodes are added, removed or reloaded, which invalidates the rank tables
+    uint64_t nListVersion;
+    // rank tables of the last blocks asked for, most recently used first
+    std::list<CMasternodeRankTable> lRankTables;
+
+    /// Get the rank table of a block, computing it if needed
+    const CMasternodeRankTable& GetRankTable(const uint256& hashBlock);
+
+    /// Check whether a peer asking for the whole list (or a diff against it) may do so now
+    bool AllowListRequest(CNode* pfrom);
+
+    void ProcessBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb);
+    void ProcessPing(CNode* pfrom, CMasternodePing& mnp);
 
 public:
     // Keep track of all broadcasts I've seen
@@ -86,6 +115,8 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
         LOCK(cs);
+        if (ser_action.ForRead())
+            nListVersion++;
         READWRITE(vMasternodes);
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
@@ -113,6 +144,12 @@ public:
     /// Clear Masternode vector
     void Clear();
 
+    /// Whether a collateral is unspent in the active chain and the mempool, false if it can't be told right now
+    bool GetCollateralState(const COutPoint& outpoint, bool& fUnspent);
+    /// Update the watched collaterals with a block connected to or disconnected from the active chain
+    void CollateralsBlockConnected(const CBlock& block);
+    void CollateralsBlockDisconnected(const CBlock& block);
+
     int CountEnabled(int protocolVersion = -1);
 
     void CountNetworks(int protocolVersion, int& ipv4, int& ipv6, int& onion);
@@ -124,6 +161,9 @@ public:
     CMasternode* Find(const CTxIn& vin);
     CMasternode* Find(const CPubKey& pubKeyMasternode);
 
+    /// Copy out the masternode key of an entry, safe to call from any thread
+    bool GetMasternodePubKey(const CTxIn& vin, CPubKey& pubKeyMasternodeRet);
+
     /// Find an entry in the masternode list that is next to be paid
     CMasternode* GetNextMasternodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount);
 
@@ -136,6 +176,14 @@ public:
         return vMasternodes;
     }
 
+    /// Hash of the entries we relay (enabled, routable), equal on two nodes with the same list
+    uint256 GetListHash();
+
+    /// Compute the rank table of a block ahead of the ranking lookups against it
+    void PrepareRankTable(int64_t nBlockHeight);
+    /// Get the Masternode with the highest score for a block, enabled or not
+    bool GetTopScoreMasternode(int64_t nBlockHeight, CTxIn& vinRet);
+
     std::vector<std::pair<int, CMasternode> > GetMasternodeRanks(int64_t nBlockHeight, int minProtocol = 0);
     int GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
 
@@ -144,6 +192,13 @@ public:
     /// Return the number of (unique) Masternodes
     int size() { return vMasternodes.size(); }
 
+    /// Changes whenever Masternodes are added, removed or reloaded
+    uint64_t GetListVersion()
+    {
+        LOCK(cs);
+        return nListVersion;
+    }
+
     /// Return the number of Masternodes older than (default) 8000 seconds
     int stable_size ();
 
@@ -155,6 +210,14 @@ public:
     void UpdateMasternodeList(CMasternodeBroadcast mnb);
 };
 
+/** Access to the MN database (mncache.dat)
+ */
+class CMasternodeDB : public CFlatDB<CMasternodeMan>
+{
+public:
+    CMasternodeDB() : CFlatDB<CMasternodeMan>("mncache.dat", "MasternodeCache", BCLog::MASTERNODE) {}
+};
+
 void ThreadCheckMasternodes();
 
 #endif
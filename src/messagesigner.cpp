@@ -8,6 +8,7 @@
 #include "main.h" // For strMessageMagic
 #include "messagesigner.h"
 #include "masternodeman.h"  // For GetPublicKey (of MN from its vin)
+#include "script/sigcache.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 
@@ -56,6 +57,11 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey& pubkey, const s
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    // relayed messages are verified again by every manager that handles them,
+    // and ahead of time by the signature pre-validation workers
+    if (IsCompactSignatureCached(hash, keyID, vchSig))
+        return true;
+
     CPubKey pubkeyFromSig;
     if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
@@ -69,6 +75,7 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std
         return false;
     }
 
+    CacheCompactSignature(hash, keyID, vchSig);
     return true;
 }
 
@@ -132,9 +139,9 @@ bool CSignedMessage::CheckSignature() const
 const CPubKey CSignedMessage::GetPublicKey(std::string& strErrorRet) const
 {
     const CTxIn vin = GetVin();
-    CMasternode* pmn = mnodeman.Find(vin);
-    if(pmn) {
-        return pmn->pubKeyMasternode;
+    CPubKey pubKeyMasternode;
+    if(mnodeman.GetMasternodePubKey(vin, pubKeyMasternode)) {
+        return pubKeyMasternode;
     }
     strErrorRet = strprintf("Unable to find masternode vin %s", vin.prevout.hash.GetHex());
     return CPubKey();
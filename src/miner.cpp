@@ -537,6 +537,8 @@ bool ProcessBlockFound(CBlock* pblock, CWallet& wallet, Optional<CReserveKey>& r
     if (!ProcessNewBlock(state, nullptr, pblock, nullptr, g_connman.get())) {
         return error("RPDCHAINMiner : ProcessNewBlock, block not accepted");
     }
+    // Let the wallet catch up, so the next stake doesn't use coins spent by this one
+    SyncWithValidationInterfaceQueue();
 
     g_connman->ForEachNode([&pblock](CNode* node)
     {
@@ -698,13 +698,21 @@ void CNode::copyStats(CNodeStats& stats)
     {
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
+        X(mapSendMsgsPerMsgCmd);
         X(nSendBytes);
     }
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
+        X(mapRecvMsgsPerMsgCmd);
         X(nRecvBytes);
     }
+    {
+        LOCK(cs_processTime);
+        X(mapProcessTimePerMsgCmd);
+    }
+    X(nSendMessagesTime);
+    X(nGetDataTime);
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -770,6 +778,7 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete
                 i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
             assert(i != mapRecvBytesPerMsgCmd.end());
             i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+            mapRecvMsgsPerMsgCmd[i->first]++;
 
             msg.nTime = nTimeMicros;
             complete = true;
@@ -779,6 +788,17 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+void CNode::AddProcessTime(const std::string& strCommand, int64_t nTimeMicros)
+{
+    LOCK(cs_processTime);
+    // only known commands get their own entry, like in mapRecvBytesPerMsgCmd
+    mapMsgCmdSize::iterator i = mapProcessTimePerMsgCmd.find(strCommand);
+    if (i == mapProcessTimePerMsgCmd.end())
+        i = mapProcessTimePerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapProcessTimePerMsgCmd.end());
+    i->second += nTimeMicros;
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -859,7 +879,7 @@ size_t CConnman::SocketSendData(CNode* pnode)
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto& data = *it;
+        const auto& data = **it;
         assert(data.size() > pnode->nSendOffset);
         int nBytes = 0;
         {
@@ -1578,10 +1598,20 @@ void CConnman::ThreadDNSAddressSeed()
 
 void CConnman::DumpAddresses()
 {
+    // Rewriting an unchanged peers.dat only costs time, at shutdown in particular.
+    uint64_t nModifications = addrman.GetModifications();
+    if (fAddrmanDumped && nModifications == nAddrmanDumpedModifications) {
+        LogPrint(BCLog::NET, "No address changes since the last flush, peers.dat left as is\n");
+        return;
+    }
+
     int64_t nStart = GetTimeMillis();
 
     CAddrDB adb;
-    adb.Write(addrman);
+    if (adb.Write(addrman)) {
+        fAddrmanDumped = true;
+        nAddrmanDumpedModifications = nModifications;
+    }
 
     LogPrint(BCLog::NET, "Flushed %d addresses to peers.dat  %dms\n",
         addrman.size(), GetTimeMillis() - nStart);
@@ -1701,9 +1731,16 @@ void CConnman::ThreadOpenConnections()
 
         addrman.ResolveCollisions();
 
+        // Don't spend 100 selections when none of the known addresses can be used.
+        bool fHaveReachable = false;
+        for (int n = 0; n < NET_MAX && !fHaveReachable; n++) {
+            enum Network net = (enum Network)n;
+            fHaveReachable = !IsLimited(net) && (addrman.size(net, true) > 0 || addrman.size(net, false) > 0);
+        }
+
         int64_t nANow = GetAdjustedTime();
         int nTries = 0;
-        while (!interruptNet) {
+        while (!interruptNet && fHaveReachable) {
             CAddrInfo addr = addrman.SelectTriedCollision();
 
             // SelectTriedCollision returns an invalid address if it is empty.
@@ -1871,7 +1908,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     return true;
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nThread)
 {
     while (!flagInterruptMsgProc) {
         std::vector<CNode*> vNodesCopy;
@@ -1885,21 +1922,35 @@ void CConnman::ThreadMessageHandler()
 
         bool fMoreWork = false;
 
-        for (CNode* pnode : vNodesCopy) {
+        // Each handler thread starts at a different peer, so they don't queue up behind each other
+        const size_t nNodes = vNodesCopy.size();
+        const size_t nStart = nNodes * nThread / nMessageHandlerThreads;
+        for (size_t i = 0; i < nNodes; i++) {
+            CNode* pnode = vNodesCopy[(nStart + i) % nNodes];
             if (pnode->fDisconnect)
                 continue;
 
+            // Skip the peers another thread is handling: messages of a peer are processed one at a time
+            bool fExpected = false;
+            if (!pnode->fMessageHandlerBusy.compare_exchange_strong(fExpected, true))
+                continue;
+
             // Receive messages
             bool fMoreNodeWork = GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
-            if (flagInterruptMsgProc)
+            if (flagInterruptMsgProc) {
+                pnode->fMessageHandlerBusy = false;
                 return;
+            }
 
             // Send messages
             {
                 LOCK(pnode->cs_sendProcessing);
+                int64_t nTimeStart = GetTimeMicros();
                 GetNodeSignals().SendMessages(pnode, *this, flagInterruptMsgProc);
+                pnode->nSendMessagesTime += GetTimeMicros() - nTimeStart;
             }
+            pnode->fMessageHandlerBusy = false;
             if (flagInterruptMsgProc)
                 return;
         }
@@ -2054,12 +2105,15 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
 {
     setBannedIsDirty = false;
     fAddressesInitialized = false;
+    fAddrmanDumped = false;
+    nAddrmanDumpedModifications = 0;
     nLastNodeId = 0;
     nSendBufferMaxSize = 0;
     nReceiveFloodSize = 0;
     semOutbound = NULL;
     nMaxConnections = 0;
     nMaxOutbound = 0;
+    nMessageHandlerThreads = 1;
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
@@ -2080,6 +2134,7 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxConnections = connOptions.nMaxConnections;
     nMaxOutbound = std::min(connOptions.nMaxOutbound, nMaxConnections);
     nMaxFeeler = connOptions.nMaxFeeler;
+    nMessageHandlerThreads = std::max(1, std::min(connOptions.nMessageHandlerThreads, MAX_MESSAGE_HANDLER_THREADS));
 
     nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
     nReceiveFloodSize = connOptions.nReceiveFloodSize;
@@ -2093,9 +2148,11 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     int64_t nStart = GetTimeMillis();
     {
         CAddrDB adb;
-        if (adb.Read(addrman))
+        if (adb.Read(addrman)) {
             LogPrintf("Loaded %i addresses from peers.dat  %dms\n", addrman.size(), GetTimeMillis() - nStart);
-        else {
+            fAddrmanDumped = true;
+            nAddrmanDumpedModifications = addrman.GetModifications();
+        } else {
             addrman.Clear(); // Addrman can be in an inconsistent state after failure, reset it
             LogPrintf("Invalid or missing peers.dat; recreating\n");
             DumpAddresses();
@@ -2170,7 +2227,8 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < nMessageHandlerThreads; i++)
+        threadMessageHandlers.emplace_back(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
 
     // Dump network addresses
     scheduler.scheduleEvery(boost::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL);
@@ -2219,8 +2277,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& threadMessageHandler : threadMessageHandlers) {
+        if (threadMessageHandler.joinable())
+            threadMessageHandler.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2496,11 +2557,18 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
     fPauseRecv = false;
     fPauseSend = false;
+    fMessageHandlerBusy = false;
     nProcessQueueSize = 0;
 
-    for (const std::string &msg : getAllNetMessageTypes())
+    nSendMessagesTime = 0;
+    nGetDataTime = 0;
+
+    for (const std::string &msg : getAllNetMessageTypes()) {
         mapRecvBytesPerMsgCmd[msg] = 0;
+        mapProcessTimePerMsgCmd[msg] = 0;
+    }
     mapRecvBytesPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
+    mapProcessTimePerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
 
     if (fLogIPs)
         LogPrint(BCLog::NET, "Added connection to %s peer=%d\n", addrName, id);
@@ -2551,19 +2619,65 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+CSharedNetMsg::CSharedNetMsg(CSerializedNetMsg&& msg) : command(std::move(msg.command))
 {
     size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->id);
-
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
     uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
+    CMessageHeader hdr(Params().MessageStart(), command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
+    std::vector<unsigned char> serializedHeader;
+    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    header = std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader));
+    if (nMessageSize)
+        data = std::make_shared<const std::vector<unsigned char>>(std::move(msg.data));
+}
+
+void CSharedNetMsgCache::Insert(const CInv& inv, int nVersion, int64_t nTag, const CSharedNetMsg& msg)
+{
+    size_t nMsgSize = msg.data ? msg.data->size() : 0;
+    if (nMsgSize > nMaxSize)
+        return;
+
+    LOCK(cs);
+    auto it = mapEntries.find(inv);
+    if (it != mapEntries.end()) {
+        nSize -= it->second.msg.data ? it->second.msg.data->size() : 0;
+        it->second = Entry{nVersion, nTag, msg};
+    } else {
+        mapEntries.emplace(inv, Entry{nVersion, nTag, msg});
+        vInsertionOrder.push_back(inv);
+    }
+    nSize += nMsgSize;
+
+    // Peers still sending an evicted message keep their reference to it.
+    while (nSize > nMaxSize) {
+        auto itOldest = mapEntries.find(vInsertionOrder.front());
+        nSize -= itOldest->second.msg.data ? itOldest->second.msg.data->size() : 0;
+        mapEntries.erase(itOldest);
+        vInsertionOrder.pop_front();
+    }
+}
+
+void CSharedNetMsgCache::Clear()
+{
+    LOCK(cs);
+    mapEntries.clear();
+    vInsertionOrder.clear();
+    nSize = 0;
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    PushMessage(pnode, CSharedNetMsg(std::move(msg)));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg)
+{
+    size_t nMessageSize = msg.data ? msg.data->size() : 0;
+    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->id);
 
     size_t nBytesSent = 0;
     {
@@ -2572,13 +2686,14 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->mapSendMsgsPerMsgCmd[msg.command]++;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
+        pnode->vSendMsg.push_back(msg.header);
         if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+            pnode->vSendMsg.push_back(msg.data);
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
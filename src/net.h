@@ -25,6 +25,8 @@
 
 #include <atomic>
 #include <deque>
+#include <map>
+#include <set>
 #include <stdint.h>
 #include <thread>
 #include <memory>
@@ -76,6 +78,10 @@ static const bool DEFAULT_UPNP = false;
 static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
+/** Default number of threads processing peer messages */
+static const int DEFAULT_MESSAGE_HANDLER_THREADS = 2;
+/** Maximum number of threads processing peer messages */
+static const int MAX_MESSAGE_HANDLER_THREADS = 16;
 /** Disconnected peers are added to setOffsetDisconnectedPeers only if node has less than ENOUGH_CONNECTIONS */
 #define ENOUGH_CONNECTIONS 2
 /** Maximum number of peers added to setOffsetDisconnectedPeers before triggering a warning */
@@ -119,6 +125,67 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * A message serialized once, header and checksum included, whose buffers
+ * are shared by the send queues of all the peers it is pushed to.
+ */
+struct CSharedNetMsg
+{
+    CSharedNetMsg() = default;
+    explicit CSharedNetMsg(CSerializedNetMsg&& msg);
+
+    std::string command;
+    std::shared_ptr<const std::vector<unsigned char>> header;
+    std::shared_ptr<const std::vector<unsigned char>> data; // null for an empty payload
+};
+
+/**
+ * Recently served messages, keyed by the inventory item they carry, so an
+ * object requested by many peers (a new block, a masternode announcement,
+ * a spork) is read, serialized and checksummed only once.
+ */
+class CSharedNetMsgCache
+{
+public:
+    explicit CSharedNetMsgCache(size_t nMaxSizeIn) : nMaxSize(nMaxSizeIn) {}
+
+    /**
+     * Return the message cached for inv, provided it was made for the same
+     * serialization version and tag (any value that changes along with the
+     * object, for objects updated in place), else make it and cache it.
+     */
+    template <typename Callable>
+    CSharedNetMsg Get(const CInv& inv, int nVersion, int64_t nTag, Callable&& make)
+    {
+        {
+            LOCK(cs);
+            auto it = mapEntries.find(inv);
+            if (it != mapEntries.end() && it->second.nVersion == nVersion && it->second.nTag == nTag)
+                return it->second.msg;
+        }
+        CSharedNetMsg msg(make());
+        Insert(inv, nVersion, nTag, msg);
+        return msg;
+    }
+
+    void Clear();
+
+private:
+    struct Entry {
+        int nVersion;
+        int64_t nTag;
+        CSharedNetMsg msg;
+    };
+
+    void Insert(const CInv& inv, int nVersion, int64_t nTag, const CSharedNetMsg& msg);
+
+    const size_t nMaxSize;
+    RecursiveMutex cs;
+    std::map<CInv, Entry> mapEntries;
+    std::deque<CInv> vInsertionOrder;
+    size_t nSize{0};
+};
+
 
 class CConnman
 {
@@ -142,6 +209,7 @@ public:
         CClientUIInterface* uiInterface = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        int nMessageHandlerThreads = 1;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -155,6 +223,7 @@ public:
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg);
 
     template<typename Callable>
     bool ForEachNodeContinueIf(Callable&& func)
@@ -284,7 +353,7 @@ private:
     void ThreadOpenAddedConnections();
     void ProcessOneShot();
     void ThreadOpenConnections();
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int nThread);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -344,6 +413,9 @@ private:
     bool setBannedIsDirty;
     bool fAddressesInitialized;
     CAddrMan addrman;
+    //! addrman modification counter as of the last peers.dat write, if there was one
+    bool fAddrmanDumped;
+    uint64_t nAddrmanDumpedModifications;
     std::deque<std::string> vOneShots;
     RecursiveMutex cs_vOneShots;
     std::vector<std::string> vAddedNodes;
@@ -363,6 +435,7 @@ private:
     int nMaxConnections;
     int nMaxOutbound;
     int nMaxFeeler;
+    int nMessageHandlerThreads;
     std::atomic<int> nBestHeight;
     CClientUIInterface* clientInterface;
 
@@ -382,7 +455,7 @@ private:
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover(boost::thread_group& threadGroup);
@@ -483,8 +556,13 @@ public:
     int nStartingHeight;
     uint64_t nSendBytes;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
+    mapMsgCmdSize mapSendMsgsPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapRecvMsgsPerMsgCmd;
+    mapMsgCmdSize mapProcessTimePerMsgCmd;
+    int64_t nSendMessagesTime;
+    int64_t nGetDataTime;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -506,12 +584,15 @@ public:
 
     int64_t nTime; // time (in microseconds) of message receipt.
 
+    bool fPreValidationQueued; // already considered for the block and signature pre-validators
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
+        fPreValidationQueued = false;
     }
 
     bool complete() const
@@ -544,7 +625,7 @@ public:
     size_t nSendSize;   // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    std::deque<std::shared_ptr<const std::vector<unsigned char>>> vSendMsg;
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
@@ -593,9 +674,20 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Set while a message handler thread owns this node, so its messages are processed in order
+    std::atomic_bool fMessageHandlerBusy;
+    // Time spent in SendMessages for this peer and serving the getdata requests left over
+    // once their message was processed, in microseconds
+    std::atomic<int64_t> nSendMessagesTime;
+    std::atomic<int64_t> nGetDataTime;
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
+    mapMsgCmdSize mapSendMsgsPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapRecvMsgsPerMsgCmd;
+    // Time spent in ProcessMessage per command, in microseconds
+    RecursiveMutex cs_processTime;
+    mapMsgCmdSize mapProcessTimePerMsgCmd;
 
     std::vector<std::string> vecRequestsFulfilled; //keep track of what client has asked for
 
@@ -604,6 +696,8 @@ public:
     std::atomic<int> nStartingHeight;
 
     // flood relay
+    // cs_addrSend guards vAddrToSend and addrKnown, other peers' handlers relay addresses to us
+    RecursiveMutex cs_addrSend;
     std::vector<CAddress> vAddrToSend;
     CRollingBloomFilter addrKnown;
     bool fGetAddr;
@@ -613,6 +707,9 @@ public:
 
     // inventory based relay
     CRollingBloomFilter filterInventoryKnown;
+    // Transactions to announce with the next trickle, kept sorted and free of duplicates.
+    // Other inventory (blocks, masternode and budget objects) goes out right away.
+    std::set<uint256> setInventoryTxToSend;
     std::vector<CInv> vInventoryToSend;
     RecursiveMutex cs_inventory;
     std::multimap<int64_t, CInv> mapAskFor;
@@ -710,6 +807,7 @@ public:
 
     void AddAddressKnown(const CAddress& _addr)
     {
+        LOCK(cs_addrSend);
         addrKnown.insert(_addr.GetKey());
     }
 
@@ -718,6 +816,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrSend);
         if (_addr.IsValid() && !addrKnown.contains(_addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = _addr;
@@ -740,8 +839,11 @@ public:
     {
         {
             LOCK(cs_inventory);
-            if (inv.type == MSG_TX && filterInventoryKnown.contains(inv.hash))
+            if (inv.type == MSG_TX) {
+                if (!filterInventoryKnown.contains(inv.hash))
+                    setInventoryTxToSend.insert(inv.hash);
                 return;
+            }
             vInventoryToSend.push_back(inv);
         }
     }
@@ -782,6 +884,9 @@ public:
 
     void copyStats(CNodeStats& stats);
 
+    //! Account the time taken by ProcessMessage for a message from this peer.
+    void AddProcessTime(const std::string& strCommand, int64_t nTimeMicros);
+
     ServiceFlags GetLocalServices() const
     {
         return nLocalServices;
@@ -49,10 +49,13 @@ const char* GETMNWINNERS = "mnget";
 const char* BUDGETPROPOSAL = "mprop";
 const char* BUDGETVOTE = "mvote";
 const char* BUDGETVOTESYNC = "mnvs";
+const char* BUDGETVOTESYNCDIFF = "mnvsdiff";
 const char* FINALBUDGET = "fbs";
 const char* FINALBUDGETVOTE = "fbvote";
 const char* SYNCSTATUSCOUNT = "ssc";
 const char* GETMNLIST = "dseg";
+const char* GETMNLISTDIFF = "dsegdiff";
+const char* MNLISTDIFF = "mnlistdiff";
 }; // namespace NetMsgType
 
 static const char* ppszTypeName[] = {
@@ -110,9 +113,12 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::MNWINNER,
     NetMsgType::GETMNWINNERS,
     NetMsgType::GETMNLIST,
+    NetMsgType::GETMNLISTDIFF,
+    NetMsgType::MNLISTDIFF,
     NetMsgType::BUDGETPROPOSAL,
     NetMsgType::BUDGETVOTE,
     NetMsgType::BUDGETVOTESYNC,
+    NetMsgType::BUDGETVOTESYNCDIFF,
     NetMsgType::FINALBUDGET,
     NetMsgType::FINALBUDGETVOTE,
     NetMsgType::SYNCSTATUSCOUNT
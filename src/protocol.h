@@ -259,6 +259,18 @@ extern const char* GETMNWINNERS;
 * The dseg message is used to request the Masternode list or an specific entry
 */
 extern const char* GETMNLIST;
+/**
+ * The dsegdiff message is used to request the differences between the sender's
+ * Masternode list, given as salted short ids of its entries, and ours
+ */
+extern const char* GETMNLISTDIFF;
+/**
+ * The mnlistdiff message answers dsegdiff with the broadcasts of the entries
+ * the requester is missing or has outdated, and the ids of those we don't have.
+ * The broadcasts are split over several messages, each giving the number of
+ * broadcasts left from its own, so the last one is known.
+ */
+extern const char* MNLISTDIFF;
 /**
  * The budgetproposal message is used to broadcast or relay budget proposal metadata to connected peers
  */
@@ -271,6 +283,11 @@ extern const char* BUDGETVOTE;
  * The budgetvotesync message is used to request budget vote data from connected peers
  */
 extern const char* BUDGETVOTESYNC;
+/**
+ * The mnvsdiff message is used to request budget vote data from connected peers,
+ * leaving out the items and votes matching the digest it carries
+ */
+extern const char* BUDGETVOTESYNCDIFF;
 /**
  * The finalbudget message is used to broadcast or relay finalized budget metadata to connected peers
  */
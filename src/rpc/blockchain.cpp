@@ -172,8 +172,7 @@ UniValue getblockcount(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainHeight();
 }
 
 UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -189,8 +188,7 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetChainTipSnapshot()->hashBlock.GetHex();
 }
 
 void RPCNotifyBlockChange(bool fInitialDownload, const CBlockIndex* pindex)
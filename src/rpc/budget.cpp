@@ -524,7 +524,7 @@ UniValue getnextsuperblock(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getnextsuperblock", "") + HelpExampleRpc("getnextsuperblock", ""));
 
-    int nChainHeight = WITH_LOCK(cs_main, return chainActive.Height());
+    int nChainHeight = GetChainHeight();
     if (nChainHeight < 0) return "unknown";
 
     const int nBlocksPerCycle = Params().GetConsensus().nBudgetCycleBlocks;
@@ -127,6 +127,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"estimatesmartfee", 0},
         {"prioritisetransaction", 1},
         {"prioritisetransaction", 2},
+        {"getnettrafficstats", 0},
         {"setban", 2},
         {"setban", 3},
         {"spork", 1},
@@ -54,7 +54,7 @@ UniValue listmasternodes(const JSONRPCRequest& request)
             HelpExampleCli("listmasternodes", "") + HelpExampleRpc("listmasternodes", ""));
 
     UniValue ret(UniValue::VARR);
-    int nHeight = WITH_LOCK(cs_main, return chainActive.Height());
+    int nHeight = GetChainHeight();
     if (nHeight < 0) return "[]";
 
     std::vector<std::pair<int, CMasternode> > vMasternodeRanks = mnodeman.GetMasternodeRanks(nHeight);
@@ -120,7 +120,7 @@ UniValue getmasternodecount (const JSONRPCRequest& request)
     int nCount = 0;
     int ipv4 = 0, ipv6 = 0, onion = 0;
 
-    int nChainHeight = WITH_LOCK(cs_main, return chainActive.Height());
+    int nChainHeight = GetChainHeight();
     if (nChainHeight < 0) return "unknown";
 
     mnodeman.GetNextMasternodeInQueueForPayment(nChainHeight, true, nCount);
@@ -156,7 +156,7 @@ UniValue masternodecurrent (const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("masternodecurrent", "") + HelpExampleRpc("masternodecurrent", ""));
 
-    const int nHeight = WITH_LOCK(cs_main, return chainActive.Height() + 1);
+    const int nHeight = GetChainHeight() + 1;
     int nCount = 0;
     CMasternode* winner = mnodeman.GetNextMasternodeInQueueForPayment(nHeight, true, nCount);
     if (winner) {
@@ -559,7 +559,7 @@ UniValue getmasternodewinners (const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getmasternodewinners", "") + HelpExampleRpc("getmasternodewinners", ""));
 
-    int nHeight = WITH_LOCK(cs_main, return chainActive.Height());
+    int nHeight = GetChainHeight();
     if (nHeight < 0) return "[]";
 
     int nLast = 10;
@@ -643,22 +643,13 @@ UniValue getmasternodescores (const JSONRPCRequest& request)
             throw std::runtime_error("Exception on param 2");
         }
     }
-    int nChainHeight = WITH_LOCK(cs_main, return chainActive.Height());
+    int nChainHeight = GetChainHeight();
     if (nChainHeight < 0) return "unknown";
     UniValue obj(UniValue::VOBJ);
-    std::vector<CMasternode> vMasternodes = mnodeman.GetFullMasternodeVector();
     for (int nHeight = nChainHeight - nLast; nHeight < nChainHeight + 20; nHeight++) {
-        uint256 nHigh;
-        CMasternode* pBestMasternode = NULL;
-        for (CMasternode& mn : vMasternodes) {
-            uint256 n = mn.CalculateScore(1, nHeight - 100);
-            if (n > nHigh) {
-                nHigh = n;
-                pBestMasternode = &mn;
-            }
-        }
-        if (pBestMasternode)
-            obj.push_back(Pair(strprintf("%d", nHeight), pBestMasternode->vin.prevout.hash.ToString().c_str()));
+        CTxIn vin;
+        if (mnodeman.GetTopScoreMasternode(nHeight - 100, vin))
+            obj.push_back(Pair(strprintf("%d", nHeight), vin.prevout.hash.ToString().c_str()));
     }
 
     return obj;
@@ -188,6 +188,8 @@ UniValue generate(const JSONRPCRequest& request)
         CValidationState state;
         if (!ProcessNewBlock(state, nullptr, pblock, nullptr, g_connman.get()))
             throw JSONRPCError(RPC_INTERNAL_ERROR, "ProcessNewBlock, block not accepted");
+        // the wallet must see this block before staking on top of it
+        SyncWithValidationInterfaceQueue();
 
         ++nHeight;
         blockHashes.push_back(pblock->GetHash().GetHex());
@@ -708,6 +710,8 @@ UniValue submitblock(const JSONRPCRequest& request)
     RegisterValidationInterface(&sc);
     bool fAccepted = ProcessNewBlock(state, nullptr, &block, nullptr, g_connman.get());
     UnregisterValidationInterface(&sc);
+    // make sure no queued notification still runs on sc, and the wallet has seen the block
+    SyncWithValidationInterfaceQueue();
     if (fBlockPresent) {
         if (fAccepted && !sc.found)
             return "duplicate-inconclusive";
@@ -62,6 +62,16 @@ UniValue ping(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue MsgCmdMapToJSON(const mapMsgCmdSize& mapPerMsgCmd)
+{
+    UniValue obj(UniValue::VOBJ);
+    for (const mapMsgCmdSize::value_type& i : mapPerMsgCmd) {
+        if (i.second > 0)
+            obj.pushKV(i.first, i.second);
+    }
+    return obj;
+}
+
 UniValue getpeerinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -103,6 +113,20 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "       \"addr\": n,             (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
             "    }\n"
+            "    \"msgssent_per_msg\": {\n"
+            "       \"addr\": n,             (numeric) The number of messages sent aggregated by message type\n"
+            "       ...\n"
+            "    }\n"
+            "    \"msgsrecv_per_msg\": {\n"
+            "       \"addr\": n,             (numeric) The number of messages received aggregated by message type\n"
+            "       ...\n"
+            "    }\n"
+            "    \"processtime_per_msg\": {\n"
+            "       \"addr\": n,             (numeric) The time spent processing received messages, in microseconds, aggregated by message type\n"
+            "       ...\n"
+            "    }\n"
+            "    \"sendmessagestime\": n,    (numeric) The time spent preparing messages to this peer, in microseconds\n"
+            "    \"getdatatime\": n,         (numeric) The time spent serving getdata requests of this peer left over after their getdata message, in microseconds\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -155,19 +179,13 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.push_back(Pair("whitelisted", stats.fWhitelisted));
 
-        UniValue sendPerMsgCmd(UniValue::VOBJ);
-        for (const mapMsgCmdSize::value_type &i : stats.mapSendBytesPerMsgCmd) {
-            if (i.second > 0)
-                sendPerMsgCmd.pushKV(i.first, i.second);
-        }
-        obj.pushKV("bytessent_per_msg", sendPerMsgCmd);
-
-        UniValue recvPerMsgCmd(UniValue::VOBJ);
-        for (const mapMsgCmdSize::value_type &i : stats.mapRecvBytesPerMsgCmd) {
-            if (i.second > 0)
-                recvPerMsgCmd.pushKV(i.first, i.second);
-        }
-        obj.pushKV("bytesrecv_per_msg", recvPerMsgCmd);
+        obj.pushKV("bytessent_per_msg", MsgCmdMapToJSON(stats.mapSendBytesPerMsgCmd));
+        obj.pushKV("bytesrecv_per_msg", MsgCmdMapToJSON(stats.mapRecvBytesPerMsgCmd));
+        obj.pushKV("msgssent_per_msg", MsgCmdMapToJSON(stats.mapSendMsgsPerMsgCmd));
+        obj.pushKV("msgsrecv_per_msg", MsgCmdMapToJSON(stats.mapRecvMsgsPerMsgCmd));
+        obj.pushKV("processtime_per_msg", MsgCmdMapToJSON(stats.mapProcessTimePerMsgCmd));
+        obj.pushKV("sendmessagestime", stats.nSendMessagesTime);
+        obj.pushKV("getdatatime", stats.nGetDataTime);
 
         ret.push_back(obj);
     }
@@ -338,6 +356,125 @@ UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getnettrafficstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getnettrafficstats ( count )\n"
+            "\nReturns the traffic and processing time of the connected peers, summed by message type,\n"
+            "and the peers that took the most processing time.\n"
+
+            "\nArguments:\n"
+            "1. count    (numeric, optional, default=10) The number of peers to list\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"per_msg\": {\n"
+            "    \"addr\": {             (object) Totals for a message type\n"
+            "      \"bytessent\": n,     (numeric) Bytes sent\n"
+            "      \"bytesrecv\": n,     (numeric) Bytes received\n"
+            "      \"msgssent\": n,      (numeric) Messages sent\n"
+            "      \"msgsrecv\": n,      (numeric) Messages received\n"
+            "      \"processtime\": n    (numeric) Time spent processing received messages, in microseconds\n"
+            "    },\n"
+            "    ...\n"
+            "  },\n"
+            "  \"peers\": [            (array) Peers by decreasing total processing time\n"
+            "    {\n"
+            "      \"id\": n,            (numeric) Peer index\n"
+            "      \"addr\": \"host:port\",  (string) The ip address and port of the peer\n"
+            "      \"totaltime\": n,     (numeric) Sum of the three times below, in microseconds\n"
+            "      \"processtime\": n,   (numeric) Time spent processing its messages, in microseconds\n"
+            "      \"sendmessagestime\": n, (numeric) Time spent preparing messages to it, in microseconds\n"
+            "      \"getdatatime\": n,   (numeric) Time spent serving its getdata requests left over after their getdata message, in microseconds\n"
+            "      \"bytessent\": n,     (numeric) The total bytes sent\n"
+            "      \"bytesrecv\": n,     (numeric) The total bytes received\n"
+            "      \"conntime\": ttt     (numeric) The connection time in seconds since epoch (Jan 1 1970 GMT)\n"
+            "    },\n"
+            "    ...\n"
+            "  ]\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getnettrafficstats", "") + HelpExampleCli("getnettrafficstats", "20") + HelpExampleRpc("getnettrafficstats", "20"));
+
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    int nCount = 10;
+    if (request.params.size() > 0)
+        nCount = request.params[0].get_int();
+    if (nCount < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count, must be positive");
+
+    std::vector<CNodeStats> vstats;
+    g_connman->GetNodeStats(vstats);
+
+    struct MsgCmdTotals {
+        uint64_t nBytesSent{0};
+        uint64_t nBytesRecv{0};
+        uint64_t nMsgsSent{0};
+        uint64_t nMsgsRecv{0};
+        uint64_t nProcessTime{0};
+    };
+    std::map<std::string, MsgCmdTotals> mapTotals;
+    std::vector<std::pair<int64_t, const CNodeStats*> > vPeers;
+    for (const CNodeStats& stats : vstats) {
+        for (const mapMsgCmdSize::value_type& i : stats.mapSendBytesPerMsgCmd)
+            mapTotals[i.first].nBytesSent += i.second;
+        for (const mapMsgCmdSize::value_type& i : stats.mapRecvBytesPerMsgCmd)
+            mapTotals[i.first].nBytesRecv += i.second;
+        for (const mapMsgCmdSize::value_type& i : stats.mapSendMsgsPerMsgCmd)
+            mapTotals[i.first].nMsgsSent += i.second;
+        for (const mapMsgCmdSize::value_type& i : stats.mapRecvMsgsPerMsgCmd)
+            mapTotals[i.first].nMsgsRecv += i.second;
+        int64_t nProcessTime = 0;
+        for (const mapMsgCmdSize::value_type& i : stats.mapProcessTimePerMsgCmd) {
+            mapTotals[i.first].nProcessTime += i.second;
+            nProcessTime += i.second;
+        }
+        vPeers.emplace_back(nProcessTime + stats.nSendMessagesTime + stats.nGetDataTime, &stats);
+    }
+
+    UniValue perMsg(UniValue::VOBJ);
+    for (const auto& i : mapTotals) {
+        const MsgCmdTotals& totals = i.second;
+        if (!totals.nBytesSent && !totals.nBytesRecv && !totals.nProcessTime)
+            continue;
+        UniValue msgObj(UniValue::VOBJ);
+        msgObj.pushKV("bytessent", totals.nBytesSent);
+        msgObj.pushKV("bytesrecv", totals.nBytesRecv);
+        msgObj.pushKV("msgssent", totals.nMsgsSent);
+        msgObj.pushKV("msgsrecv", totals.nMsgsRecv);
+        msgObj.pushKV("processtime", totals.nProcessTime);
+        perMsg.pushKV(i.first, msgObj);
+    }
+
+    std::sort(vPeers.begin(), vPeers.end(), [](const std::pair<int64_t, const CNodeStats*>& a, const std::pair<int64_t, const CNodeStats*>& b) {
+        return a.first > b.first;
+    });
+    UniValue peers(UniValue::VARR);
+    for (size_t i = 0; i < vPeers.size() && (int)i < nCount; i++) {
+        const CNodeStats& stats = *vPeers[i].second;
+        UniValue peerObj(UniValue::VOBJ);
+        peerObj.pushKV("id", stats.nodeid);
+        peerObj.pushKV("addr", stats.addrName);
+        peerObj.pushKV("totaltime", vPeers[i].first);
+        peerObj.pushKV("processtime", vPeers[i].first - stats.nSendMessagesTime - stats.nGetDataTime);
+        peerObj.pushKV("sendmessagestime", stats.nSendMessagesTime);
+        peerObj.pushKV("getdatatime", stats.nGetDataTime);
+        peerObj.pushKV("bytessent", stats.nSendBytes);
+        peerObj.pushKV("bytesrecv", stats.nRecvBytes);
+        peerObj.pushKV("conntime", stats.nTimeConnected);
+        peers.push_back(peerObj);
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("per_msg", perMsg);
+    obj.pushKV("peers", peers);
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
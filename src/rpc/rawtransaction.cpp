@@ -22,6 +22,7 @@
 #include "swifttx.h"
 #include "uint256.h"
 #include "utilmoneystr.h"
+#include "validationinterface.h"
 #include "zrpdchain.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
@@ -874,6 +875,7 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
                 throw JSONRPCError(RPC_TRANSACTION_ERROR, state.GetRejectReason());
             }
         }
+        SyncWithValidationInterfaceQueue();
     } else if (fHaveChain) {
         throw JSONRPCError(RPC_TRANSACTION_ALREADY_IN_CHAIN, "transaction already in block chain");
     }
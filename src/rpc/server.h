@@ -197,6 +197,7 @@ extern UniValue addnode(const JSONRPCRequest& request);
 extern UniValue disconnectnode(const JSONRPCRequest& request);
 extern UniValue getaddednodeinfo(const JSONRPCRequest& request);
 extern UniValue getnettotals(const JSONRPCRequest& request);
+extern UniValue getnettrafficstats(const JSONRPCRequest& request);
 extern UniValue setban(const JSONRPCRequest& request);
 extern UniValue listbanned(const JSONRPCRequest& request);
 extern UniValue clearbanned(const JSONRPCRequest& request);
@@ -121,3 +121,83 @@ size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
     }
     return result;
 }
+
+
+void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(m_cs_callbacks_pending);
+        // Try to avoid scheduling too many copies here, but if we
+        // accidentally have two ProcessQueue's scheduled at once its
+        // not a big deal.
+        if (m_are_callbacks_running) return;
+        if (m_callbacks_pending.empty()) return;
+    }
+    m_pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this), boost::chrono::system_clock::now());
+}
+
+void SingleThreadedSchedulerClient::ProcessQueue()
+{
+    CScheduler::Function callback;
+    {
+        boost::unique_lock<boost::mutex> lock(m_cs_callbacks_pending);
+        if (m_are_callbacks_running) return;
+        if (m_callbacks_pending.empty()) return;
+        m_are_callbacks_running = true;
+
+        callback = std::move(m_callbacks_pending.front());
+        m_callbacks_pending.pop_front();
+    }
+
+    // RAII the setting of fCallbacksRunning and calling MaybeScheduleProcessQueue
+    // to ensure both happen safely even if callback() throws.
+    struct RAIICallbacksRunning {
+        SingleThreadedSchedulerClient* instance;
+        explicit RAIICallbacksRunning(SingleThreadedSchedulerClient* _instance) : instance(_instance) {}
+        ~RAIICallbacksRunning()
+        {
+            {
+                boost::unique_lock<boost::mutex> lock(instance->m_cs_callbacks_pending);
+                instance->m_are_callbacks_running = false;
+            }
+            instance->m_callbacks_drained.notify_all();
+            instance->MaybeScheduleProcessQueue();
+        }
+    } raiicallbacksrunning(this);
+
+    callback();
+}
+
+void SingleThreadedSchedulerClient::AddToProcessQueue(CScheduler::Function func)
+{
+    assert(m_pscheduler);
+
+    {
+        boost::unique_lock<boost::mutex> lock(m_cs_callbacks_pending);
+        m_callbacks_pending.emplace_back(std::move(func));
+    }
+    MaybeScheduleProcessQueue();
+}
+
+void SingleThreadedSchedulerClient::EmptyQueue()
+{
+    bool should_continue = true;
+    while (should_continue) {
+        ProcessQueue();
+        boost::unique_lock<boost::mutex> lock(m_cs_callbacks_pending);
+        should_continue = !m_callbacks_pending.empty();
+    }
+}
+
+void SingleThreadedSchedulerClient::WaitForQueue(size_t nMaxPending)
+{
+    boost::unique_lock<boost::mutex> lock(m_cs_callbacks_pending);
+    while (m_callbacks_pending.size() > nMaxPending || (nMaxPending == 0 && m_are_callbacks_running))
+        m_callbacks_drained.wait(lock);
+}
+
+size_t SingleThreadedSchedulerClient::CallbacksPending() const
+{
+    boost::unique_lock<boost::mutex> lock(m_cs_callbacks_pending);
+    return m_callbacks_pending.size();
+}
@@ -13,6 +13,7 @@
 //
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
+#include <deque>
 #include <map>
 
 //
@@ -80,4 +81,41 @@ private:
     bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
 };
 
+/**
+ * Class used by CScheduler clients which may schedule multiple jobs
+ * which are required to be run serially. Jobs may not be run on the
+ * same thread, but no two jobs will be executed at the same time,
+ * and jobs are run in the order they were added.
+ */
+class SingleThreadedSchedulerClient
+{
+private:
+    CScheduler* m_pscheduler;
+
+    mutable boost::mutex m_cs_callbacks_pending;
+    boost::condition_variable m_callbacks_drained;
+    std::deque<CScheduler::Function> m_callbacks_pending;
+    bool m_are_callbacks_running = false;
+
+    void MaybeScheduleProcessQueue();
+    void ProcessQueue();
+
+public:
+    explicit SingleThreadedSchedulerClient(CScheduler* pschedulerIn) : m_pscheduler(pschedulerIn) {}
+
+    // Add a callback to be executed. Callbacks are executed serially
+    // and memory is release-acquire consistent between callback executions.
+    void AddToProcessQueue(CScheduler::Function func);
+
+    // Processes all remaining queue members on the calling thread, blocking until queue is empty.
+    // Must be called after the CScheduler has no remaining processing threads!
+    void EmptyQueue();
+
+    // Blocks until the queue holds at most nMaxPending callbacks, none of
+    // them running when nMaxPending is zero.
+    void WaitForQueue(size_t nMaxPending);
+
+    size_t CallbacksPending() const;
+};
+
 #endif
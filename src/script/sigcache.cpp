@@ -42,6 +42,14 @@ public:
         CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(&pubkey[0], pubkey.size()).Write(&vchSig[0], vchSig.size()).Finalize(entry.begin());
     }
 
+    //! Entries of compact signatures are SHA256(nonce || 'C' || hash || key id || signature)
+    void
+    ComputeCompactEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID)
+    {
+        static const unsigned char tag = 'C';
+        CSHA256().Write(nonce.begin(), 32).Write(&tag, 1).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
     bool
     Get(const uint256& entry, const bool erase)
     {
@@ -93,3 +101,17 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
         signatureCache.Set(entry);
     return true;
 }
+
+bool IsCompactSignatureCached(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig)
+{
+    uint256 entry;
+    signatureCache.ComputeCompactEntry(entry, hash, vchSig, keyID);
+    return signatureCache.Get(entry, false);
+}
+
+void CacheCompactSignature(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig)
+{
+    uint256 entry;
+    signatureCache.ComputeCompactEntry(entry, hash, vchSig, keyID);
+    signatureCache.Set(entry);
+}
@@ -17,6 +17,7 @@ static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
+class CKeyID;
 class CPubKey;
 
 /**
@@ -53,4 +54,9 @@ public:
 
 void InitSignatureCache();
 
+/** Whether a compact (message) signature of hash by keyID is known to be valid */
+bool IsCompactSignatureCached(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig);
+/** Remember a valid compact signature, so verifying it again is a cache lookup */
+void CacheCompactSignature(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
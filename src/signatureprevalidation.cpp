@@ -0,0 +1,114 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "signatureprevalidation.h"
+
+#include "masternode.h"
+#include "masternode-budget.h"
+#include "masternode-payments.h"
+#include "protocol.h"
+#include "util.h"
+
+#include <boost/thread.hpp>
+
+CSignaturePreValidator signaturePreValidator;
+
+bool CSignaturePreValidator::IsSignedMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::MNPING ||
+           strCommand == NetMsgType::MNWINNER ||
+           strCommand == NetMsgType::BUDGETVOTE ||
+           strCommand == NetMsgType::FINALBUDGETVOTE;
+}
+
+void CSignaturePreValidator::Submit(const std::string& strCommand, const CDataStream& vRecv, int nRecvVersion)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (nWorkers == 0 || queue.size() >= MAX_SIGNATURE_PREVALIDATION_QUEUE)
+        return;
+    queue.push_back(QueuedMessage{strCommand, vRecv});
+    queue.back().vRecv.SetVersion(nRecvVersion);
+    condWorker.notify_one();
+}
+
+template <typename T>
+static void VerifySignedMessage(CDataStream& vRecv)
+{
+    T msg;
+    vRecv >> msg;
+    // messages of unknown masternodes are left to the managers, which ask peers for them
+    std::string strError;
+    const CPubKey pubkey = msg.GetPublicKey(strError);
+    if (!pubkey.IsValid())
+        return;
+    // valid signatures end up in the signature cache, the result itself isn't needed here
+    msg.CheckSignature(pubkey);
+}
+
+void CSignaturePreValidator::Verify(const std::string& strCommand, CDataStream& vRecv)
+{
+    if (strCommand == NetMsgType::MNPING)
+        VerifySignedMessage<CMasternodePing>(vRecv);
+    else if (strCommand == NetMsgType::MNWINNER)
+        VerifySignedMessage<CMasternodePaymentWinner>(vRecv);
+    else if (strCommand == NetMsgType::BUDGETVOTE)
+        VerifySignedMessage<CBudgetVote>(vRecv);
+    else if (strCommand == NetMsgType::FINALBUDGETVOTE)
+        VerifySignedMessage<CFinalizedBudgetVote>(vRecv);
+}
+
+void CSignaturePreValidator::Thread()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nWorkers++;
+    }
+    try {
+        std::vector<QueuedMessage> vBatch;
+        while (true) {
+            vBatch.clear();
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty())
+                    condWorker.wait(lock);
+                while (!queue.empty() && vBatch.size() < SIGNATURE_PREVALIDATION_BATCH) {
+                    vBatch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+
+            for (QueuedMessage& msg : vBatch) {
+                boost::this_thread::interruption_point();
+                try {
+                    Verify(msg.strCommand, msg.vRecv);
+                } catch (const std::exception& e) {
+                    // malformed messages are reported by ProcessMessages
+                    continue;
+                }
+            }
+        }
+    } catch (const boost::thread_interrupted&) {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nWorkers--;
+        throw;
+    }
+}
+
+bool CSignaturePreValidator::IsEnabled()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nWorkers > 0;
+}
+
+void CSignaturePreValidator::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    queue.clear();
+}
+
+void ThreadSignaturePreValidation()
+{
+    util::ThreadRename("rpdchain-sigprev");
+    signaturePreValidator.Thread();
+}
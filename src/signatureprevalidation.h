@@ -0,0 +1,66 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPDCHAIN_SIGNATUREPREVALIDATION_H
+#define RPDCHAIN_SIGNATUREPREVALIDATION_H
+
+#include "streams.h"
+
+#include <deque>
+#include <string>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** Default for -sigprevalidationthreads, number of masternode message signature workers (0 = disabled) */
+static const int DEFAULT_SIGNATURE_PREVALIDATION_THREADS = 2;
+/** Maximum number of masternode message signature workers */
+static const int MAX_SIGNATURE_PREVALIDATION_THREADS = 8;
+/** Maximum number of queued messages waiting for a worker */
+static const size_t MAX_SIGNATURE_PREVALIDATION_QUEUE = 4096;
+/** Number of queued messages a worker takes at once */
+static const size_t SIGNATURE_PREVALIDATION_BATCH = 64;
+
+/**
+ * Verifies the signatures of masternode pings, payment winners and budget
+ * votes on a pool of worker threads as soon as they are queued for a peer.
+ * Valid signatures are recorded in the signature cache, where the managers'
+ * own CheckSignature() calls find them when the messages are processed. A
+ * message is queued at most once, and anything the workers could not check
+ * (unknown masternode, full queue) is simply verified by the manager.
+ */
+class CSignaturePreValidator
+{
+private:
+    struct QueuedMessage {
+        std::string strCommand;
+        CDataStream vRecv;
+    };
+
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+    std::deque<QueuedMessage> queue;
+    int nWorkers{0};
+
+    static void Verify(const std::string& strCommand, CDataStream& vRecv);
+
+public:
+    /** Whether messages of this type carry a signature the workers can check. */
+    static bool IsSignedMessage(const std::string& strCommand);
+
+    /** Copy a serialized message payload and queue it for signature verification. */
+    void Submit(const std::string& strCommand, const CDataStream& vRecv, int nRecvVersion);
+
+    /** Worker loop, run by each pre-validation thread until interrupted. */
+    void Thread();
+
+    bool IsEnabled();
+    void Clear();
+};
+
+extern CSignaturePreValidator signaturePreValidator;
+
+void ThreadSignaturePreValidation();
+
+#endif // RPDCHAIN_SIGNATUREPREVALIDATION_H
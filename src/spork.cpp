@@ -36,12 +36,30 @@ CSporkManager::CSporkManager()
         sporkDefsById.emplace(sporkDef.sporkId, &sporkDef);
         sporkDefsByName.emplace(sporkDef.name, &sporkDef);
     }
+    ResetSporkValues();
 }
 
 void CSporkManager::Clear()
 {
+    LOCK(cs);
     strMasterPrivKey = "";
     mapSporksActive.clear();
+    ResetSporkValues();
+}
+
+void CSporkManager::SetSporkValue(const CSporkMessage& spork)
+{
+    int nIndex = spork.nSporkID - SPORK_2_SWIFTTX;
+    if (nIndex >= 0 && nIndex < SPORK_VALUES_SIZE)
+        arrSporkValues[nIndex].store(spork.nValue, std::memory_order_relaxed);
+}
+
+void CSporkManager::ResetSporkValues()
+{
+    for (auto& value : arrSporkValues)
+        value.store(-1, std::memory_order_relaxed);
+    for (const auto& sporkDef : sporkDefs)
+        arrSporkValues[sporkDef.sporkId - SPORK_2_SWIFTTX].store(sporkDef.defaultValue, std::memory_order_relaxed);
 }
 
 // RPDCHAIN: on startup load spork values from previous session if they exist in the sporkDB
@@ -56,8 +74,12 @@ void CSporkManager::LoadSporksFromDB()
         }
 
         // add spork to memory
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        {
+            LOCK(cs);
+            mapSporks[spork.GetHash()] = spork;
+            mapSporksActive[spork.nSporkID] = spork;
+            SetSporkValue(spork);
+        }
         std::time_t result = spork.nValue;
         // If SPORK Value is greater than 1,000,000 assume it's actually a Date and then convert to a more readable format
         std::string sporkName = sporkManager.GetSporkNameByID(spork.nSporkID);
@@ -143,6 +165,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
             LOCK(cs);
             mapSporks[hash] = spork;
             mapSporksActive[spork.nSporkID] = spork;
+            SetSporkValue(spork);
         }
         spork.Relay();
 
@@ -169,6 +192,7 @@ bool CSporkManager::UpdateSpork(SporkId nSporkID, int64_t nValue)
         LOCK(cs);
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[nSporkID] = spork;
+        SetSporkValue(spork);
         return true;
     }
 
@@ -184,20 +208,13 @@ bool CSporkManager::IsSporkActive(SporkId nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(SporkId nSporkID)
 {
-    LOCK(cs);
-
-    if (mapSporksActive.count(nSporkID)) {
-        return mapSporksActive[nSporkID].nValue;
-
-    } else {
-        auto it = sporkDefsById.find(nSporkID);
-        if (it != sporkDefsById.end()) {
-            return it->second->defaultValue;
-        } else {
-            LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
-        }
+    int nIndex = nSporkID - SPORK_2_SWIFTTX;
+    if (nIndex >= 0 && nIndex < SPORK_VALUES_SIZE) {
+        int64_t nValue = arrSporkValues[nIndex].load(std::memory_order_relaxed);
+        if (nValue != -1) return nValue;
     }
 
+    LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
     return -1;
 }
 
@@ -18,6 +18,9 @@
 
 #include "protocol.h"
 
+#include <array>
+#include <atomic>
+
 
 class CSporkMessage;
 class CSporkManager;
@@ -93,6 +96,14 @@ private:
     std::map<std::string, CSporkDef*> sporkDefsByName;
     std::map<SporkId, CSporkMessage> mapSporksActive;
 
+    // value of each spork (network or default), indexed by nSporkID - SPORK_2_SWIFTTX and read without taking cs
+    static const int SPORK_VALUES_SIZE = SPORK_18_ZEROCOIN_PUBLICSPEND_V4 - SPORK_2_SWIFTTX + 1;
+    std::array<std::atomic<int64_t>, SPORK_VALUES_SIZE> arrSporkValues;
+
+    // publish the value of an active spork, or the defaults of all of them
+    void SetSporkValue(const CSporkMessage& spork);
+    void ResetSporkValues();
+
 public:
     CSporkManager();
 
@@ -103,6 +114,11 @@ public:
     {
         READWRITE(mapSporksActive);
         // we don't serialize private key to prevent its leakage
+        if (ser_action.ForRead()) {
+            ResetSporkValues();
+            for (const auto& it : mapSporksActive)
+                SetSporkValue(it.second);
+        }
     }
 
     void Clear();
@@ -41,6 +41,8 @@ private:
 
 public:
     CRpdStake() {}
+    // input of a transaction known to be included in block pindexFrom, spares its lookup
+    CRpdStake(const CTransaction& _txFrom, unsigned int n, CBlockIndex* _pindexFrom) : txFrom(_txFrom), nPosition(n) { pindexFrom = _pindexFrom; }
 
     bool InitFromTxIn(const CTxIn& txin) override;
     bool SetPrevout(CTransaction txPrev, unsigned int n);
@@ -19,15 +19,38 @@
 #include "validationinterface.h"
 #include <boost/foreach.hpp>
 
+#include <set>
+
 
 std::map<uint256, CTransaction> mapTxLockReq;
 std::map<uint256, CTransaction> mapTxLockReqRejected;
 std::map<uint256, CConsensusVote> mapTxLockVote;
 std::map<uint256, CTransactionLock> mapTxLocks;
-std::map<COutPoint, uint256> mapLockedInputs;
+std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> mapLockedInputs;
+std::set<std::pair<int, uint256> > setTxLockExpirations; //locks by expiration time, for cleanup
 std::map<uint256, int64_t> mapUnknownVotes; //track votes with no tx for DOS
+int64_t nUnknownVotesTimeTotal = 0; //sum of the times in mapUnknownVotes
 int nCompleteTXLocks;
 
+static void SetLockExpiration(CTransactionLock& lock, int nExpiration)
+{
+    setTxLockExpirations.erase(std::make_pair(lock.nExpiration, lock.txHash));
+    lock.nExpiration = nExpiration;
+    setTxLockExpirations.insert(std::make_pair(lock.nExpiration, lock.txHash));
+}
+
+static void SetUnknownVoteTime(const uint256& hash, int64_t nTime)
+{
+    std::map<uint256, int64_t>::iterator it = mapUnknownVotes.find(hash);
+    if (it != mapUnknownVotes.end()) {
+        nUnknownVotesTimeTotal += nTime - it->second;
+        it->second = nTime;
+    } else {
+        nUnknownVotesTimeTotal += nTime;
+        mapUnknownVotes.insert(std::make_pair(hash, nTime));
+    }
+}
+
 //txlock - Locks transaction
 //
 //step 1.) Broadcast intention to lock transaction inputs, "txlreg", CTransaction
@@ -149,7 +172,7 @@ void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& v
             */
             if (!mapTxLockReq.count(ctx.txHash) && !mapTxLockReqRejected.count(ctx.txHash)) {
                 if (!mapUnknownVotes.count(ctx.vinMasternode.prevout.hash)) {
-                    mapUnknownVotes[ctx.vinMasternode.prevout.hash] = GetTime() + (60 * 10);
+                    SetUnknownVoteTime(ctx.vinMasternode.prevout.hash, GetTime() + (60 * 10));
                 }
 
                 if (mapUnknownVotes[ctx.vinMasternode.prevout.hash] > GetTime() &&
@@ -159,7 +182,7 @@ void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& v
                         ctx.txHash.ToString().c_str());
                     return;
                 } else {
-                    mapUnknownVotes[ctx.vinMasternode.prevout.hash] = GetTime() + (60 * 10);
+                    SetUnknownVoteTime(ctx.vinMasternode.prevout.hash, GetTime() + (60 * 10));
                 }
             }
             g_connman->RelayInv(inv);
@@ -222,7 +245,7 @@ bool IsIXTXValid(const CTransaction& txCollateral)
 
 int64_t CreateNewLock(CTransaction tx)
 {
-    int nChainHeight = WITH_LOCK(cs_main, return chainActive.Height(); );
+    int nChainHeight = GetChainHeight();
     int64_t nTxAge = 0;
     BOOST_REVERSE_FOREACH (CTxIn i, tx.vin) {
         nTxAge = pcoinsTip->GetCoinDepthAtHeight(i.prevout, nChainHeight);
@@ -250,6 +273,7 @@ int64_t CreateNewLock(CTransaction tx)
         newLock.nTimeout = GetTime() + (60 * 5);
         newLock.txHash = tx.GetHash();
         mapTxLocks.insert(std::make_pair(tx.GetHash(), newLock));
+        setTxLockExpirations.insert(std::make_pair(newLock.nExpiration, newLock.txHash));
     } else {
         mapTxLocks[tx.GetHash()].nBlockHeight = nBlockHeight;
         LogPrint(BCLog::MASTERNODE, "%s : Transaction Lock Exists %s !\n", __func__, tx.GetHash().ToString().c_str());
@@ -342,6 +366,7 @@ bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
         newLock.nTimeout = GetTime() + (60 * 5);
         newLock.txHash = ctx.txHash;
         mapTxLocks.insert(std::make_pair(ctx.txHash, newLock));
+        setTxLockExpirations.insert(std::make_pair(newLock.nExpiration, newLock.txHash));
     } else
         LogPrint(BCLog::MASTERNODE, "%s : Transaction Lock Exists %s !\n", __func__, ctx.txHash.ToString().c_str());
 
@@ -409,63 +434,66 @@ bool CheckForConflictingLocks(CTransaction& tx)
         rescan the blocks and find they're acceptable and then take the chain with the most work.
     */
     for (const CTxIn& in : tx.vin) {
-        if (mapLockedInputs.count(in.prevout)) {
-            if (mapLockedInputs[in.prevout] != tx.GetHash()) {
-                LogPrintf("%s : found two complete conflicting locks - removing both. %s %s", __func__,
-                        tx.GetHash().ToString().c_str(), mapLockedInputs[in.prevout].ToString().c_str());
-                if (mapTxLocks.count(tx.GetHash())) mapTxLocks[tx.GetHash()].nExpiration = GetTime();
-                if (mapTxLocks.count(mapLockedInputs[in.prevout])) mapTxLocks[mapLockedInputs[in.prevout]].nExpiration = GetTime();
-                return true;
-            }
+        auto it = mapLockedInputs.find(in.prevout);
+        if (it != mapLockedInputs.end() && it->second != tx.GetHash()) {
+            const uint256 hashConflict = it->second;
+            LogPrintf("%s : found two complete conflicting locks - removing both. %s %s", __func__,
+                    tx.GetHash().ToString().c_str(), hashConflict.ToString().c_str());
+            if (mapTxLocks.count(tx.GetHash())) SetLockExpiration(mapTxLocks[tx.GetHash()], GetTime());
+            if (mapTxLocks.count(hashConflict)) SetLockExpiration(mapTxLocks[hashConflict], GetTime());
+            return true;
         }
     }
 
     return false;
 }
 
-int64_t GetAverageVoteTime()
+bool HasConflictingLock(const CTransaction& tx)
 {
-    std::map<uint256, int64_t>::iterator it = mapUnknownVotes.begin();
-    int64_t total = 0;
-    int64_t count = 0;
-
-    while (it != mapUnknownVotes.end()) {
-        total += it->second;
-        count++;
-        it++;
+    for (const CTxIn& in : tx.vin) {
+        auto it = mapLockedInputs.find(in.prevout);
+        if (it != mapLockedInputs.end() && it->second != tx.GetHash())
+            return true;
     }
 
-    return total / count;
+    return false;
+}
+
+int64_t GetAverageVoteTime()
+{
+    if (mapUnknownVotes.empty()) return 0;
+    return nUnknownVotesTimeTotal / (int64_t)mapUnknownVotes.size();
 }
 
 void CleanTransactionLocksList()
 {
     if (chainActive.Tip() == NULL) return;
 
-    std::map<uint256, CTransactionLock>::iterator it = mapTxLocks.begin();
+    // locks come out of the expiration set in time order, so only the expired ones are visited
+    while (!setTxLockExpirations.empty() && GetTime() > setTxLockExpirations.begin()->first) { //keep them for an hour
+        const uint256 txHash = setTxLockExpirations.begin()->second;
+        setTxLockExpirations.erase(setTxLockExpirations.begin());
 
-    while (it != mapTxLocks.end()) {
-        if (GetTime() > it->second.nExpiration) { //keep them for an hour
-            LogPrintf("%s : Removing old transaction lock %s\n", __func__,
-                    it->second.txHash.ToString().c_str());
+        std::map<uint256, CTransactionLock>::iterator it = mapTxLocks.find(txHash);
+        if (it == mapTxLocks.end()) continue;
 
-            if (mapTxLockReq.count(it->second.txHash)) {
-                CTransaction& tx = mapTxLockReq[it->second.txHash];
+        LogPrintf("%s : Removing old transaction lock %s\n", __func__,
+                it->second.txHash.ToString().c_str());
 
-                for (const CTxIn& in : tx.vin)
-                    mapLockedInputs.erase(in.prevout);
+        if (mapTxLockReq.count(it->second.txHash)) {
+            CTransaction& tx = mapTxLockReq[it->second.txHash];
 
-                mapTxLockReq.erase(it->second.txHash);
-                mapTxLockReqRejected.erase(it->second.txHash);
+            for (const CTxIn& in : tx.vin)
+                mapLockedInputs.erase(in.prevout);
 
-                for (CConsensusVote& v : it->second.vecConsensusVotes)
-                    mapTxLockVote.erase(v.GetHash());
-            }
+            mapTxLockReq.erase(it->second.txHash);
+            mapTxLockReqRejected.erase(it->second.txHash);
 
-            mapTxLocks.erase(it++);
-        } else {
-            it++;
+            for (CConsensusVote& v : it->second.vecConsensusVotes)
+                mapTxLockVote.erase(v.GetHash());
         }
+
+        mapTxLocks.erase(it);
     }
 }
 
@@ -524,6 +552,7 @@ bool CTransactionLock::SignaturesValid()
 void CTransactionLock::AddSignature(CConsensusVote& cv)
 {
     vecConsensusVotes.push_back(cv);
+    mapVotesByHeight[cv.nBlockHeight]++;
 }
 
 int CTransactionLock::CountSignatures()
@@ -535,11 +564,6 @@ int CTransactionLock::CountSignatures()
 
     if (nBlockHeight == 0) return -1;
 
-    int n = 0;
-    for (CConsensusVote v : vecConsensusVotes) {
-        if (v.nBlockHeight == nBlockHeight) {
-            n++;
-        }
-    }
-    return n;
+    std::map<int, int>::const_iterator it = mapVotesByHeight.find(nBlockHeight);
+    return it != mapVotesByHeight.end() ? it->second : 0;
 }
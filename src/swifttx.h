@@ -7,6 +7,7 @@
 #define SWIFTTX_H
 
 #include "base58.h"
+#include "coins.h"
 #include "key.h"
 #include "main.h"
 #include "net.h"
@@ -37,7 +38,7 @@ extern std::map<uint256, CTransaction> mapTxLockReq;
 extern std::map<uint256, CTransaction> mapTxLockReqRejected;
 extern std::map<uint256, CConsensusVote> mapTxLockVote;
 extern std::map<uint256, CTransactionLock> mapTxLocks;
-extern std::map<COutPoint, uint256> mapLockedInputs;
+extern std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> mapLockedInputs;
 extern int nCompleteTXLocks;
 
 
@@ -48,6 +49,9 @@ bool IsIXTXValid(const CTransaction& txCollateral);
 // if two conflicting locks are approved by the network, they will cancel out
 bool CheckForConflictingLocks(CTransaction& tx);
 
+// whether an input of the transaction is locked by another transaction
+bool HasConflictingLock(const CTransaction& tx);
+
 void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
 //check if we need to vote on this transaction
@@ -109,6 +113,7 @@ public:
     int nBlockHeight;
     uint256 txHash;
     std::vector<CConsensusVote> vecConsensusVotes;
+    std::map<int, int> mapVotesByHeight; // number of votes by the block height they were cast for
     int nExpiration;
     int nTimeout;
 
@@ -28,13 +28,17 @@
 // Tests this internal-to-main.cpp method:
 extern bool AddOrphanTx(const CTransaction& tx, NodeId peer);
 extern void EraseOrphansFor(NodeId peer);
-extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans, size_t nMaxOrphansSize);
 struct COrphanTx {
     CTransaction tx;
     NodeId fromPeer;
+    int64_t nTimeExpire;
+    unsigned int nTxSize;
 };
 extern std::map<uint256, COrphanTx> mapOrphanTransactions;
-extern std::map<uint256, std::set<uint256> > mapOrphanTransactionsByPrev;
+extern std::map<COutPoint, std::set<uint256> > mapOrphanTransactionsByPrev;
+extern size_t nOrphanTransactionsSize;
+extern std::map<NodeId, size_t> mapOrphanTransactionsSizeByPeer;
 
 CService ip(uint32_t i)
 {
@@ -213,14 +217,40 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
         BOOST_CHECK(mapOrphanTransactions.size() < sizeBefore);
     }
 
+    // A single peer cannot take more than its share of the pool:
+    const size_t nPeerQuota = DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE * 1000000 / ORPHAN_TX_PEER_SHARE;
+    const NodeId nodeFlood = 1000;
+    bool fRejected = false;
+    for (size_t n = 0; n < nPeerQuota && !fRejected; n++)
+    {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = 0;
+        tx.vin[0].prevout.hash = InsecureRand256();
+        tx.vin[0].scriptSig << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1*CENT;
+        tx.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+        fRejected = !AddOrphanTx(tx, nodeFlood);
+    }
+    BOOST_CHECK(fRejected);
+    BOOST_CHECK(mapOrphanTransactionsSizeByPeer[nodeFlood] <= nPeerQuota);
+    EraseOrphansFor(nodeFlood);
+    BOOST_CHECK(!mapOrphanTransactionsSizeByPeer.count(nodeFlood));
+
     // Test LimitOrphanTxSize() function:
-    LimitOrphanTxSize(40);
+    LimitOrphanTxSize(40, nOrphanTransactionsSize);
     BOOST_CHECK(mapOrphanTransactions.size() <= 40);
-    LimitOrphanTxSize(10);
+    LimitOrphanTxSize(10, nOrphanTransactionsSize);
     BOOST_CHECK(mapOrphanTransactions.size() <= 10);
-    LimitOrphanTxSize(0);
+    LimitOrphanTxSize(10, 500);
+    BOOST_CHECK(nOrphanTransactionsSize <= 500);
+    LimitOrphanTxSize(0, 0);
     BOOST_CHECK(mapOrphanTransactions.empty());
     BOOST_CHECK(mapOrphanTransactionsByPrev.empty());
+    BOOST_CHECK(mapOrphanTransactionsSizeByPeer.empty());
+    BOOST_CHECK_EQUAL(nOrphanTransactionsSize, 0);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
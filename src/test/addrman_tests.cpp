@@ -8,6 +8,7 @@
 #include <boost/test/unit_test.hpp>
 #include <crypto/common.h> // for ReadLE64
 
+#include "clientversion.h"
 #include "hash.h"
 #include "netbase.h"
 #include "random.h"
@@ -432,6 +433,54 @@ BOOST_AUTO_TEST_CASE(addrman_getaddr)
     BOOST_CHECK(addrman.size() == 2007);
 }
 
+BOOST_AUTO_TEST_CASE(addrman_network_counts)
+{
+    CAddrManTest addrman;
+
+    // Set addrman addr placement to be deterministic.
+    addrman.MakeDeterministic();
+
+    CNetAddr source = ResolveIP("252.2.2.2");
+    CService addr1 = ResolveService("250.1.1.1", 8333);
+    CService addr2 = ResolveService("250.2.2.2", 8333);
+    CService addr3 = ResolveService("2001:4860::1", 8333);
+
+    uint64_t nModifications = addrman.GetModifications();
+    addrman.Add(CAddress(addr1, NODE_NONE), source);
+    addrman.Add(CAddress(addr2, NODE_NONE), source);
+    addrman.Add(CAddress(addr3, NODE_NONE), source);
+    BOOST_CHECK(addrman.GetModifications() != nModifications);
+    BOOST_CHECK_EQUAL(addrman.size(NET_IPV4, false), 2);
+    BOOST_CHECK_EQUAL(addrman.size(NET_IPV6, false), 1);
+    BOOST_CHECK_EQUAL(addrman.size(NET_TOR, false), 0);
+
+    // Moving an entry to tried moves its count along.
+    addrman.Good(CAddress(addr1, NODE_NONE));
+    BOOST_CHECK_EQUAL(addrman.size(NET_IPV4, false), 1);
+    BOOST_CHECK_EQUAL(addrman.size(NET_IPV4, true), 1);
+
+    // Only the tried entry can be picked from the tried table, and only new ones with newOnly.
+    for (int i = 0; i < 20; i++) {
+        BOOST_CHECK(addrman.Select(true).ToString() != "250.1.1.1:8333");
+        BOOST_CHECK(addrman.Select().IsValid());
+    }
+
+    // The counts are rebuilt when loading.
+    CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
+    ssPeers << addrman;
+    CAddrMan addrman2;
+    ssPeers >> addrman2;
+    BOOST_CHECK_EQUAL(addrman2.size(), 3);
+    BOOST_CHECK_EQUAL(addrman2.size(NET_IPV4, true), 1);
+    BOOST_CHECK_EQUAL(addrman2.size(NET_IPV4, false), 1);
+    BOOST_CHECK_EQUAL(addrman2.size(NET_IPV6, false), 1);
+    BOOST_CHECK_EQUAL(addrman2.GetModifications(), 0);
+
+    addrman2.Clear();
+    BOOST_CHECK_EQUAL(addrman2.size(NET_IPV4, true), 0);
+    BOOST_CHECK(!addrman2.Select().IsValid());
+}
+
 
 BOOST_AUTO_TEST_CASE(caddrinfo_get_tried_bucket)
 {
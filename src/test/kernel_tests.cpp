@@ -0,0 +1,91 @@
+// Copyright (c) 2020 The RPDCHAIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "kernel.h"
+#include "legacy/stakemodifier.h"
+#include "main.h"
+#include "stakeinput.h"
+#include "test/test_rpdchain.h"
+
+#include <limits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(kernel_tests, BasicTestingSetup)
+
+static CTransaction StakeTx(CAmount nValue)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = nValue;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    return CTransaction(mtx);
+}
+
+// CStakeCandidate must give the same kernel hash and result as CStakeKernel for every block time
+static void CheckCandidateMatchesKernel(const CBlockIndex* pindexPrev, CRpdStake& stake, unsigned int nBits, int nTimeStart)
+{
+    const CStakeCandidate candidate(pindexPrev, &stake, nBits);
+    for (int nTimeTx = nTimeStart; nTimeTx < nTimeStart + 64 * 15; nTimeTx += 15) {
+        const CStakeKernel kernel(pindexPrev, &stake, nBits, nTimeTx);
+        BOOST_CHECK(candidate.GetHash(nTimeTx) == kernel.GetHash());
+        BOOST_CHECK_EQUAL(candidate.CheckKernelHash(nTimeTx), kernel.CheckKernelHash(true));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stake_candidate_v1_modifier)
+{
+    // V1 modifiers are looked up on the active chain, a selection interval after the coin's block
+    const int nBaseTime = 1500000000;
+    std::vector<uint256> vHashes(200);
+    std::vector<CBlockIndex> vIndex(200);
+    for (int i = 0; i < (int)vIndex.size(); i++) {
+        vHashes[i] = GetRandHash();
+        vIndex[i].phashBlock = &vHashes[i];
+        vIndex[i].nHeight = i;
+        vIndex[i].nTime = nBaseTime + 60 * i;
+        vIndex[i].pprev = (i == 0) ? nullptr : &vIndex[i - 1];
+        vIndex[i].SetStakeModifier((uint64_t)GetRand(std::numeric_limits<uint64_t>::max()), i % 10 == 0);
+    }
+    chainActive.SetTip(&vIndex.back());
+
+    const CBlockIndex* pindexPrev = &vIndex.back();
+    BOOST_CHECK(!Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V3_4));
+    CRpdStake stake(StakeTx(1000 * COIN), 0, &vIndex[10]);
+    uint64_t nStakeModifier = 0;
+    BOOST_CHECK(GetOldStakeModifier(&stake, nStakeModifier));
+    BOOST_CHECK(nStakeModifier != 0);
+
+    CheckCandidateMatchesKernel(pindexPrev, stake, 0x1d00ffff, pindexPrev->nTime);
+
+    chainActive.SetTip(nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(stake_candidate_v2_modifier)
+{
+    // V2 modifiers are taken from pindexPrev itself
+    const int nHeight = Params().GetConsensus().vUpgrades[Consensus::UPGRADE_V3_4].nActivationHeight;
+    uint256 hashFrom = GetRandHash();
+    CBlockIndex indexFrom;
+    indexFrom.phashBlock = &hashFrom;
+    indexFrom.nHeight = nHeight - 1000;
+    indexFrom.nTime = 1600000000;
+
+    uint256 hashPrev = GetRandHash();
+    CBlockIndex indexPrev;
+    indexPrev.phashBlock = &hashPrev;
+    indexPrev.nHeight = nHeight;
+    indexPrev.nTime = indexFrom.nTime + 60 * 1000;
+    indexPrev.SetStakeModifier(GetRandHash());
+    BOOST_CHECK(Params().GetConsensus().NetworkUpgradeActive(indexPrev.nHeight + 1, Consensus::UPGRADE_V3_4));
+    BOOST_CHECK(!indexPrev.GetStakeModifierV2().IsNull());
+
+    CRpdStake stake(StakeTx(1000 * COIN), 0, &indexFrom);
+    CheckCandidateMatchesKernel(&indexPrev, stake, 0x1d00ffff, indexPrev.nTime);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
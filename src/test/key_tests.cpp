@@ -6,7 +6,9 @@
 #include "key.h"
 
 #include "base58.h"
+#include "messagesigner.h"
 #include "script/script.h"
+#include "script/sigcache.h"
 #include "uint256.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -178,4 +180,26 @@ BOOST_AUTO_TEST_CASE(key_test1)
     BOOST_CHECK(detsigc == ParseHex("1f4f304f1b05599f88bc517819f6d43c69503baea5f253c55ea2d791394f7ce0de4f23c0d4c1f4d7a89bf130fed755201d22581911a8a44cf594014794231d325a"));
 }
 
+BOOST_AUTO_TEST_CASE(hash_signer_cache)
+{
+    CKey key = DecodeSecret(strSecret1C);
+    CKey key2 = DecodeSecret(strSecret2C);
+    uint256 hash = Hash(strSecret1.begin(), strSecret1.end());
+    std::vector<unsigned char> vchSig;
+    std::string strError;
+    BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+
+    // a verified signature is cached for the exact (hash, key, signature) it was checked with
+    BOOST_CHECK(!IsCompactSignatureCached(hash, key.GetPubKey().GetID(), vchSig));
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey(), vchSig, strError));
+    BOOST_CHECK(IsCompactSignatureCached(hash, key.GetPubKey().GetID(), vchSig));
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey(), vchSig, strError));
+
+    // failures are never cached, and the cache doesn't make other keys or hashes pass
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, key2.GetPubKey(), vchSig, strError));
+    BOOST_CHECK(!IsCompactSignatureCached(hash, key2.GetPubKey().GetID(), vchSig));
+    uint256 hash2 = Hash(strSecret2.begin(), strSecret2.end());
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash2, key.GetPubKey(), vchSig, strError));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
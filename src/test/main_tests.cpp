@@ -165,4 +165,18 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     BOOST_CHECK(Test());
 }
 
+BOOST_AUTO_TEST_CASE(chain_tip_snapshot_test)
+{
+    LOCK(cs_main);
+    ChainTipSnapshotRef snapshot = GetChainTipSnapshot();
+    BOOST_CHECK(snapshot);
+    BOOST_CHECK_EQUAL(snapshot->nHeight, chainActive.Height());
+    BOOST_CHECK_EQUAL(GetChainHeight(), chainActive.Height());
+    BOOST_CHECK(snapshot->pindex == chainActive.Tip());
+    if (chainActive.Tip()) {
+        BOOST_CHECK(snapshot->hashBlock == chainActive.Tip()->GetBlockHash());
+        BOOST_CHECK(snapshot->nChainWork == chainActive.Tip()->nChainWork);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -473,4 +473,46 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSortForRelayTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(1);
+    txParent.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txParent.vout[0].nValue = 10 * COIN;
+
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_11;
+    txChild.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = 9 * COIN;
+
+    CMutableTransaction txOlder;
+    txOlder.vin.resize(1);
+    txOlder.vin[0].scriptSig = CScript() << OP_12;
+    txOlder.vout.resize(1);
+    txOlder.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+    txOlder.vout[0].nValue = 5 * COIN;
+
+    // parent and child enter within the same second, after txOlder
+    pool.addUnchecked(txOlder.GetHash(), entry.Time(1).FromTx(txOlder));
+    pool.addUnchecked(txParent.GetHash(), entry.Time(2).FromTx(txParent));
+    pool.addUnchecked(txChild.GetHash(), entry.Time(2).FromTx(txChild));
+
+    std::vector<uint256> vHashes = {txChild.GetHash(), GetRandHash(), txParent.GetHash(), txOlder.GetHash()};
+    pool.SortForRelay(vHashes);
+
+    // the unknown id is dropped, the parent goes before its child
+    BOOST_CHECK_EQUAL(vHashes.size(), 3);
+    BOOST_CHECK(vHashes[0] == txOlder.GetHash());
+    BOOST_CHECK(vHashes[1] == txParent.GetHash());
+    BOOST_CHECK(vHashes[2] == txChild.GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
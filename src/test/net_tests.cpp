@@ -7,6 +7,7 @@
 #include "hash.h"
 #include "net.h"
 #include "netbase.h"
+#include "netmessagemaker.h"
 #include "serialize.h"
 #include "streams.h"
 
@@ -176,4 +177,48 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(shared_msg_cache)
+{
+    CSharedNetMsgCache cache(100);
+    CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    CInv inv1(MSG_SPORK, GetRandHash());
+    CInv inv2(MSG_SPORK, GetRandHash());
+    int nMade = 0;
+    auto make = [&](size_t nSize) {
+        return [&nMade, &msgMaker, nSize]() {
+            nMade++;
+            return msgMaker.Make(NetMsgType::SPORK, std::vector<unsigned char>(nSize - 1));
+        };
+    };
+
+    // The header is made once and the payload shared by all callers.
+    CSharedNetMsg msg1 = cache.Get(inv1, PROTOCOL_VERSION, 0, make(60));
+    CSharedNetMsg msg1b = cache.Get(inv1, PROTOCOL_VERSION, 0, make(60));
+    BOOST_CHECK_EQUAL(nMade, 1);
+    BOOST_CHECK(msg1.header == msg1b.header && msg1.data == msg1b.data);
+    BOOST_CHECK_EQUAL(msg1.header->size(), CMessageHeader::HEADER_SIZE);
+    BOOST_CHECK_EQUAL(msg1.data->size(), 60);
+
+    // A different tag or version makes the message again.
+    cache.Get(inv1, PROTOCOL_VERSION, 1, make(60));
+    BOOST_CHECK_EQUAL(nMade, 2);
+    cache.Get(inv1, PROTOCOL_VERSION - 1, 1, make(60));
+    BOOST_CHECK_EQUAL(nMade, 3);
+
+    // Going over the size limit evicts the oldest entry, not the messages handed out.
+    cache.Get(inv2, PROTOCOL_VERSION, 0, make(60));
+    BOOST_CHECK_EQUAL(nMade, 4);
+    cache.Get(inv2, PROTOCOL_VERSION, 0, make(60));
+    BOOST_CHECK_EQUAL(nMade, 4);
+    cache.Get(inv1, PROTOCOL_VERSION, 0, make(60));
+    BOOST_CHECK_EQUAL(nMade, 5);
+    BOOST_CHECK_EQUAL(msg1.data->size(), 60);
+
+    // Messages larger than the cache are not kept.
+    CInv inv3(MSG_SPORK, GetRandHash());
+    cache.Get(inv3, PROTOCOL_VERSION, 0, make(200));
+    cache.Get(inv3, PROTOCOL_VERSION, 0, make(200));
+    BOOST_CHECK_EQUAL(nMade, 7);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
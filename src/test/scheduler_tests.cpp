@@ -109,4 +109,43 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
+{
+    CScheduler scheduler;
+
+    // each queue should be processed sequentially and in order, even with several service threads
+    SingleThreadedSchedulerClient queue1(&scheduler);
+    SingleThreadedSchedulerClient queue2(&scheduler);
+
+    boost::thread_group threads;
+    for (int i = 0; i < 5; ++i)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+
+    // the callbacks of a queue never run concurrently, so the counters need no lock
+    int counter1 = 0;
+    int counter2 = 0;
+    bool fInOrder1 = true;
+    bool fInOrder2 = true;
+    for (int i = 0; i < 100; ++i) {
+        queue1.AddToProcessQueue([i, &counter1, &fInOrder1]() {
+            fInOrder1 &= (counter1++ == i);
+        });
+        queue2.AddToProcessQueue([i, &counter2, &fInOrder2]() {
+            fInOrder2 &= (counter2++ == i);
+        });
+    }
+
+    queue1.WaitForQueue(0);
+    BOOST_CHECK_EQUAL(queue1.CallbacksPending(), 0U);
+    BOOST_CHECK_EQUAL(counter1, 100);
+    BOOST_CHECK(fInOrder1);
+
+    // finish up
+    scheduler.stop(true);
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(counter2, 100);
+    BOOST_CHECK(fInOrder2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chain.h"
 #include "serialize.h"
 #include "streams.h"
 #include "hash.h"
@@ -345,4 +346,33 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(stake_modifier_bytes)
+{
+    // CStakeModifierBytes must stay byte-compatible with the vector it replaced
+    for (size_t nSize : {0, 8, 32}) {
+        std::vector<unsigned char> vch(nSize);
+        for (size_t i = 0; i < nSize; i++)
+            vch[i] = (unsigned char)(i * 7 + 1);
+        CStakeModifierBytes modifier;
+        modifier.assign(vch.data(), vch.data() + vch.size());
+
+        CDataStream ssVector(SER_DISK, PROTOCOL_VERSION);
+        CDataStream ssModifier(SER_DISK, PROTOCOL_VERSION);
+        ssVector << vch;
+        ssModifier << modifier;
+        BOOST_CHECK(ssVector.str() == ssModifier.str());
+
+        CStakeModifierBytes modifier2;
+        ssVector >> modifier2;
+        BOOST_CHECK(modifier == modifier2);
+        BOOST_CHECK_EQUAL(modifier2.size(), nSize);
+    }
+
+    // oversized modifiers are rejected
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << std::vector<unsigned char>(33);
+    CStakeModifierBytes modifier;
+    BOOST_CHECK_THROW(ss >> modifier, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,7 +3,9 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "headerchaincache.h"
 #include "main.h"
+#include "streams.h"
 #include "util.h"
 #include "test/test_rpdchain.h"
 
@@ -100,4 +102,73 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(headerchaincache_test)
+{
+    // A main chain of 100 blocks and a fork of it branching off after height 49.
+    std::vector<uint256> vHashMain(100), vHashFork(100);
+    std::vector<CBlockIndex> vBlocksMain(100), vBlocksFork(100);
+    for (unsigned int i = 0; i < vBlocksMain.size(); i++) {
+        vHashMain[i] = i;
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].nTime = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].phashBlock = &vHashMain[i];
+        vBlocksMain[i].BuildSkip();
+        vHashFork[i] = i + 1000;
+        vBlocksFork[i].nHeight = i;
+        vBlocksFork[i].nTime = i + 1000;
+        vBlocksFork[i].pprev = i <= 50 ? vBlocksMain[i].pprev : &vBlocksFork[i - 1];
+        vBlocksFork[i].phashBlock = &vHashFork[i];
+        vBlocksFork[i].BuildSkip();
+    }
+
+    CHeaderChainCache cache;
+    BOOST_CHECK_EQUAL(cache.Height(), -1);
+    BOOST_CHECK_EQUAL(cache.FindFork(CBlockLocator()), -1);
+
+    cache.SetTip(&vBlocksMain[99]);
+    BOOST_CHECK_EQUAL(cache.Height(), 99);
+    BOOST_CHECK_EQUAL(cache.FindFork(CBlockLocator(std::vector<uint256>{vHashFork[70], vHashMain[60]})), 60);
+    BOOST_CHECK_EQUAL(cache.FindFork(CBlockLocator(std::vector<uint256>{vHashFork[70]})), 0);
+
+    std::vector<uint256> vHashes = cache.GetHashes(95, 10);
+    BOOST_CHECK(vHashes == std::vector<uint256>(vHashMain.begin() + 95, vHashMain.end()));
+    BOOST_CHECK(cache.GetHashes(100, 10).empty());
+
+    // The payload is what serializing CBlocks without transactions gives.
+    std::vector<unsigned char> vPayload;
+    BOOST_CHECK_EQUAL(cache.GetHeaders(10, 20, vHashMain[14], vPayload), 5);
+    std::vector<CBlock> vHeaders;
+    for (int i = 10; i <= 14; i++)
+        vHeaders.push_back(CBlock(vBlocksMain[i].GetBlockHeader()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << vHeaders;
+    BOOST_CHECK(vPayload == std::vector<unsigned char>(ss.begin(), ss.end()));
+    BOOST_CHECK_EQUAL(cache.GetHeaders(90, 20, uint256(), vPayload), 10);
+    BOOST_CHECK_EQUAL(cache.GetHeaders(100, 20, uint256(), vPayload), 0);
+    BOOST_CHECK_EQUAL(vPayload.size(), 1);
+
+    // Switching to the fork only replaces the blocks after the fork point.
+    cache.SetTip(&vBlocksFork[80]);
+    BOOST_CHECK_EQUAL(cache.Height(), 80);
+    BOOST_CHECK_EQUAL(cache.GetHeight(vHashMain[49]), 49);
+    BOOST_CHECK_EQUAL(cache.GetHeight(vHashMain[50]), -1);
+    BOOST_CHECK_EQUAL(cache.GetHeight(vHashFork[50]), 50);
+    BOOST_CHECK_EQUAL(cache.GetHeaders(49, 2, uint256(), vPayload), 2);
+    vHeaders = {CBlock(vBlocksMain[49].GetBlockHeader()), CBlock(vBlocksFork[50].GetBlockHeader())};
+    ss.clear();
+    ss << vHeaders;
+    BOOST_CHECK(vPayload == std::vector<unsigned char>(ss.begin(), ss.end()));
+
+    // and back, disconnecting a block at a time
+    cache.SetTip(&vBlocksFork[79]);
+    BOOST_CHECK_EQUAL(cache.GetHeight(vHashFork[80]), -1);
+    cache.SetTip(&vBlocksMain[99]);
+    BOOST_CHECK_EQUAL(cache.GetHeight(vHashMain[99]), 99);
+    BOOST_CHECK_EQUAL(cache.GetHeight(vHashFork[50]), -1);
+
+    cache.SetTip(nullptr);
+    BOOST_CHECK_EQUAL(cache.Height(), -1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,8 @@
 #include "utiltime.h"
 #include "version.h"
 
+#include <tuple>
+
 #include <boost/foreach.hpp>
 
 
@@ -734,6 +736,27 @@ bool CTxMemPool::lookup(uint256 hash, CTransaction& result) const
     return true;
 }
 
+void CTxMemPool::SortForRelay(std::vector<uint256>& vHashes) const
+{
+    // Entry times have a one second resolution: within the same second a
+    // parent still comes first, as it counts its children as descendants.
+    std::vector<std::tuple<int64_t, int64_t, uint256> > vSorted;
+    vSorted.reserve(vHashes.size());
+    {
+        LOCK(cs);
+        for (const uint256& hash : vHashes) {
+            indexed_transaction_set::const_iterator i = mapTx.find(hash);
+            if (i != mapTx.end())
+                vSorted.emplace_back(i->GetTime(), -(int64_t)i->GetCountWithDescendants(), hash);
+        }
+    }
+    std::sort(vSorted.begin(), vSorted.end());
+
+    vHashes.clear();
+    for (const auto& entry : vSorted)
+        vHashes.push_back(std::get<2>(entry));
+}
+
 CFeeRate CTxMemPool::estimateFee(int nBlocks) const
 {
     LOCK(cs);
@@ -568,6 +568,12 @@ public:
 
     bool lookup(uint256 hash, CTransaction& result) const;
 
+    /**
+     * Put transaction ids in the order they should be announced: by time of
+     * entry, parents before their children. Ids no longer in the pool are dropped.
+     */
+    void SortForRelay(std::vector<uint256>& vHashes) const;
+
     /** Estimate fee rate needed to get into the next nBlocks
      *  If no answer can be given at nBlocks, return an estimate
      *  at the lowest number of blocks where one can be given
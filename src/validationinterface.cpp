@@ -5,14 +5,89 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "validationinterface.h"
+#include "main.h"
+
+#include "primitives/transaction.h"
+#include "scheduler.h"
+#include "uint256.h"
+
+#include <assert.h>
+#include <memory>
+
+#include <boost/bind.hpp>
 
 static CMainSignals g_signals;
 
+// Serializes queued notifications; only set while a background scheduler is running
+static std::unique_ptr<SingleThreadedSchedulerClient> g_signal_queue;
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
 }
 
+static void AddToSignalQueue(CScheduler::Function func)
+{
+    if (g_signal_queue)
+        g_signal_queue->AddToProcessQueue(std::move(func));
+    else
+        func();
+}
+
+void CMainSignals::QueueUpdatedBlockTip(const CBlockIndex* pindex)
+{
+    AddToSignalQueue([this, pindex] { UpdatedBlockTip(pindex); });
+}
+
+void CMainSignals::QueueSyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
+{
+    // the transaction is copied: the caller's block or mempool entry may be gone by delivery time
+    std::shared_ptr<const CTransaction> ptx = std::make_shared<const CTransaction>(tx);
+    AddToSignalQueue([this, ptx, pindex, posInBlock] { SyncTransaction(*ptx, pindex, posInBlock); });
+}
+
+void CMainSignals::QueueUpdatedTransaction(const uint256& hash)
+{
+    AddToSignalQueue([this, hash] { UpdatedTransaction(hash); });
+}
+
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler)
+{
+    assert(!g_signal_queue);
+    g_signal_queue.reset(new SingleThreadedSchedulerClient(&scheduler));
+}
+
+void UnregisterBackgroundSignalScheduler()
+{
+    g_signal_queue.reset();
+}
+
+void FlushBackgroundCallbacks()
+{
+    if (g_signal_queue)
+        g_signal_queue->EmptyQueue();
+}
+
+size_t CallbacksPending()
+{
+    return g_signal_queue ? g_signal_queue->CallbacksPending() : 0;
+}
+
+void SyncWithValidationInterfaceQueue()
+{
+    AssertLockNotHeld(cs_main);
+    if (g_signal_queue)
+        g_signal_queue->WaitForQueue(0);
+}
+
+void LimitValidationInterfaceQueue()
+{
+    // the scheduler thread may need cs_main to drain the queue
+    AssertLockNotHeld(cs_main);
+    if (g_signal_queue)
+        g_signal_queue->WaitForQueue(MAX_VALIDATION_QUEUE_CALLBACKS);
+}
+
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
 // XX42 g_signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
     g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
@@ -15,6 +15,7 @@ struct CBlockLocator;
 class CBlockIndex;
 class CConnman;
 class CReserveScript;
+class CScheduler;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
@@ -29,6 +30,25 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
 
+/** Maximum number of queued notifications before block connection waits for listeners to catch up */
+static const size_t MAX_VALIDATION_QUEUE_CALLBACKS = 1000;
+
+/** Deliver queued notifications on the threads servicing scheduler, in the order they were queued */
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+/** Stop delivering from the background; queued notifications must have been flushed first */
+void UnregisterBackgroundSignalScheduler();
+/** Deliver all pending notifications on the calling thread, once the scheduler threads have stopped */
+void FlushBackgroundCallbacks();
+/** Number of notifications waiting to be delivered */
+size_t CallbacksPending();
+/**
+ * Block until every notification queued so far has been delivered.
+ * Must not be called with cs_main held, nor from the scheduler thread.
+ */
+void SyncWithValidationInterfaceQueue();
+/** Block while more than MAX_VALIDATION_QUEUE_CALLBACKS notifications are pending. Same restrictions as above. */
+void LimitValidationInterfaceQueue();
+
 class CValidationInterface {
 protected:
 // XX42    virtual void EraseFromWallet(const uint256& hash){};
@@ -68,6 +88,15 @@ struct CMainSignals {
 // XX42    boost::signals2::signal<void (boost::shared_ptr<CReserveScript>&)> ScriptForMining;
     /** Notifies listeners that a block has been successfully mined */
     boost::signals2::signal<void (const uint256 &)> BlockFound;
+
+    /**
+     * Queued variants of the signals above: listeners are called from the
+     * background scheduler once every earlier queued notification has been
+     * delivered, or right away when no background scheduler is registered.
+     */
+    void QueueUpdatedBlockTip(const CBlockIndex* pindex);
+    void QueueSyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock);
+    void QueueUpdatedTransaction(const uint256& hash);
 };
 
 CMainSignals& GetMainSignals();
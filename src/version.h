@@ -11,7 +11,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 70919;
+static const int PROTOCOL_VERSION = 70920;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -26,6 +26,12 @@ static const int MIN_PEER_PROTO_VERSION_AFTER_ENFORCEMENT = 70919;
 //! masternodes older than this proto version use old strMessage format for mnannounce
 static const int MIN_PEER_MNANNOUNCE = 70913;
 
+//! "dsegdiff" and "mnlistdiff" masternode list sync messages start with this version
+static const int MNLISTDIFF_VERSION = 70920;
+
+//! "mnvsdiff" budget sync message starts with this version
+static const int BUDGETVOTESYNCDIFF_VERSION = 70920;
+
 //! nTime field added to CAddress, starting with this version;
 //! if possible, avoid requesting addresses nodes older than this
 static const int CADDR_TIME_VERSION = 31402;
@@ -1313,6 +1313,8 @@ UniValue listaddressgroupings(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("listaddressgroupings", "") + HelpExampleRpc("listaddressgroupings", ""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     UniValue jsonGroupings(UniValue::VARR);
@@ -1413,6 +1415,8 @@ UniValue getreceivedbyaddress(const JSONRPCRequest& request)
             "\nAs a json rpc call\n" +
             HelpExampleRpc("getreceivedbyaddress", "\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\", 6"));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     // rpdchain address
@@ -1476,6 +1480,8 @@ UniValue getreceivedbylabel(const JSONRPCRequest& request)
             "\nAs a json rpc call\n" +
             HelpExampleRpc("getreceivedbylabel", "\"tabby\", 6"));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     // Minimum confirmations
@@ -1538,6 +1544,8 @@ UniValue getbalance(const JSONRPCRequest& request)
             "\nAs a json rpc call\n" +
             HelpExampleRpc("getbalance", "\"*\", 6"));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     if (IsDeprecatedRPCEnabled("accounts")) {
@@ -1590,6 +1598,8 @@ UniValue getcoldstakingbalance(const JSONRPCRequest& request)
             "\nAs a json rpc call\n" +
             HelpExampleRpc("getcoldstakingbalance", "\"*\""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     if (IsDeprecatedRPCEnabled("accounts")) {
@@ -1628,6 +1638,8 @@ UniValue getdelegatedbalance(const JSONRPCRequest& request)
             "\nAs a json rpc call\n" +
             HelpExampleRpc("getdelegatedbalance", "\"*\""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     if (IsDeprecatedRPCEnabled("accounts")) {
@@ -1648,6 +1660,8 @@ UniValue getunconfirmedbalance(const JSONRPCRequest& request)
             "getunconfirmedbalance\n"
             "Returns the server's total unconfirmed balance\n");
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     return ValueFromAmount(pwalletMain->GetUnconfirmedBalance());
@@ -2178,6 +2192,8 @@ UniValue listreceivedbyaddress(const JSONRPCRequest& request)
             HelpExampleRpc("listreceivedbyaddress", "6, true, true") +
             HelpExampleRpc("listreceivedbyaddress", "6, true, true, \"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     return ListReceived(request.params, false);
@@ -2218,6 +2234,8 @@ UniValue listreceivedbylabel(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("listreceivedbylabel", "") + HelpExampleCli("listreceivedbylabel", "6 true") + HelpExampleRpc("listreceivedbylabel", "6, true, true"));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     return ListReceived(request.params, true);
@@ -2250,6 +2268,8 @@ UniValue listcoldutxos(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("listcoldutxos", "") + HelpExampleCli("listcoldutxos", "true"));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     bool fExcludeWhitelisted = false;
@@ -2505,6 +2525,8 @@ UniValue listtransactions(const JSONRPCRequest& request)
 
     if (request.fHelp || request.params.size() > 6) throw std::runtime_error(help_text);
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     std::string strAccount = "*";
@@ -2609,6 +2631,8 @@ UniValue listaccounts(const JSONRPCRequest& request)
             "\nAs json rpc call\n" +
             HelpExampleRpc("listaccounts", "6"));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     int nMinDepth = 1;
@@ -2700,6 +2724,8 @@ UniValue listsinceblock(const JSONRPCRequest& request)
             HelpExampleCli("listsinceblock", "\"000000000000000bacf66f7497b7dc45ef753ee9a7d38571037cdb1a57f663ad\" 6") +
             HelpExampleRpc("listsinceblock", "\"000000000000000bacf66f7497b7dc45ef753ee9a7d38571037cdb1a57f663ad\", 6"));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     CBlockIndex* pindex = NULL;
@@ -2787,6 +2813,8 @@ UniValue gettransaction(const JSONRPCRequest& request)
             HelpExampleCli("gettransaction", "\"1075db55d416d3ca199f55b6084e2115b9345e16c5cf302fc80e9d5fbf5d48d\" true") +
             HelpExampleRpc("gettransaction", "\"1075db55d416d3ca199f55b6084e2115b9345e16c5cf302fc80e9d5fbf5d48d\""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     uint256 hash;
@@ -2843,6 +2871,8 @@ UniValue abandontransaction(const JSONRPCRequest& request)
 
     EnsureWalletIsUnlocked();
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     uint256 hash;
@@ -3210,6 +3240,8 @@ UniValue listunspent(const JSONRPCRequest& request)
     UniValue results(UniValue::VARR);
     std::vector<COutput> vecOutputs;
     assert(pwalletMain != NULL);
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
     pwalletMain->AvailableCoins(&vecOutputs,
                                 &coinControl,    // coin control
@@ -3486,6 +3518,8 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getwalletinfo", "") + HelpExampleRpc("getwalletinfo", ""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     UniValue obj(UniValue::VOBJ);
@@ -3857,6 +3891,8 @@ UniValue getzerocoinbalance(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getzerocoinbalance", "") + HelpExampleRpc("getzerocoinbalance", ""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     EnsureWalletIsUnlocked(true);
@@ -3912,6 +3948,8 @@ UniValue listmintedzerocoins(const JSONRPCRequest& request)
     bool fVerbose = (request.params.size() > 0) ? request.params[0].get_bool() : false;
     bool fMatureOnly = (request.params.size() > 1) ? request.params[1].get_bool() : false;
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     EnsureWalletIsUnlocked(true);
@@ -3976,6 +4014,8 @@ UniValue listzerocoinamounts(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("listzerocoinamounts", "") + HelpExampleRpc("listzerocoinamounts", ""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     EnsureWalletIsUnlocked(true);
@@ -4017,6 +4057,8 @@ UniValue listspentzerocoins(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("listspentzerocoins", "") + HelpExampleRpc("listspentzerocoins", ""));
 
+    pwalletMain->BlockUntilSyncedToCurrentChain();
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     EnsureWalletIsUnlocked(true);
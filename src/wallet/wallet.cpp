@@ -22,6 +22,7 @@
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
+#include <thread>
 
 CWallet* pwalletMain = nullptr;
 /**
@@ -50,6 +51,8 @@ CFeeRate CWallet::minTxFee = CFeeRate(10000);
  */
 CAmount CWallet::minStakeSplitThreshold = DEFAULT_MIN_STAKE_SPLIT_THRESHOLD;
 
+int CWallet::nStakingThreads = DEFAULT_STAKING_THREADS;
+
 const uint256 CMerkleTx::ABANDON_HASH(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
 
 /** @defgroup mapWallet
@@ -601,6 +604,11 @@ bool CWallet::ParameterInteraction()
         else
             return UIError(AmountErrMsg("minstakesplit", mapArgs["-minstakesplit"]));
     }
+    // -stakingthreads=0 means autodetect
+    nStakingThreads = GetArg("-stakingthreads", DEFAULT_STAKING_THREADS);
+    if (nStakingThreads <= 0)
+        nStakingThreads += GetNumCores();
+    nStakingThreads = std::max(1, std::min(nStakingThreads, MAX_STAKING_THREADS));
     nTxConfirmTarget = GetArg("-txconfirmtarget", 1);
     bSpendZeroConfChange = GetBoolArg("-spendzeroconfchange", DEFAULT_SPEND_ZEROCONF_CHANGE);
     bdisableSystemnotifications = GetBoolArg("-disablesystemnotifications", false);
@@ -1116,7 +1124,8 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
 
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock)
 {
-    LOCK(cs_wallet);
+    // cs_main first: MarkConflicted takes both
+    LOCK2(cs_main, cs_wallet);
     if (!AddToWalletIfInvolvingMe(tx, pindex, posInBlock, true))
         return; // Not one of ours
 
@@ -1550,6 +1559,14 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
     return ret;
 }
 
+void CWallet::BlockUntilSyncedToCurrentChain()
+{
+    // the scheduler thread needs cs_main and cs_wallet to deliver them
+    AssertLockNotHeld(cs_main);
+    AssertLockNotHeld(cs_wallet);
+    SyncWithValidationInterfaceQueue();
+}
+
 void CWallet::ReacceptWalletTransactions(bool fFirstLoad)
 {
     LOCK2(cs_main, cs_wallet);
@@ -2685,6 +2702,93 @@ bool CWallet::CreateTransaction(CScript scriptPubKey, const CAmount& nValue, CWa
     return CreateTransaction(vecSend, wtxNew, reservekey, nFeeRet, nChangePosInOut, strFailReason, coinControl, coin_type, true, useIX, nFeePay, fIncludeDelegated);
 }
 
+void CWallet::BuildStakeCandidates(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutput>& vCoins)
+{
+    AssertLockHeld(cs_stakeCandidates);
+
+    // the wallet knows the block of each coin, so no transaction lookup is needed
+    std::vector<CBlockIndex*> vIndexFrom(vCoins.size(), nullptr);
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < vCoins.size(); i++) {
+            BlockMap::const_iterator mi = mapBlockIndex.find(vCoins[i].tx->hashBlock);
+            if (mi != mapBlockIndex.end() && pindexPrev->GetAncestor(mi->second->nHeight) == mi->second)
+                vIndexFrom[i] = mi->second;
+        }
+    }
+
+    vStakeCandidates.clear();
+    vStakeCandidates.reserve(vCoins.size());
+    for (size_t i = 0; i < vCoins.size(); i++) {
+        if (!vIndexFrom[i]) continue;
+        CRpdStake stakeInput(*vCoins[i].tx, vCoins[i].i, vIndexFrom[i]);
+        vStakeCandidates.emplace_back(vCoins[i], CStakeCandidate(pindexPrev, &stakeInput, nBits));
+    }
+    hashStakeCandidatesTip = pindexPrev->GetBlockHash();
+    nStakeCandidatesBits = nBits;
+    LogPrint(BCLog::STAKING, "%s: %d stake candidates out of %d coins\n", __func__, vStakeCandidates.size(), vCoins.size());
+}
+
+/**
+ * Look for a kernel at nTimeTx among the stake candidates from nBegin on,
+ * splitting them between up to nStakingThreads threads which stop as soon as
+ * one of them finds a kernel. Return the index of the kernel found, or the
+ * number of candidates if there is none; fAbort is set if a new block came in,
+ * the wallet got locked or shutdown was requested during the search.
+ */
+size_t CWallet::SearchStakeKernel(const CBlockIndex* pindexPrev, size_t nBegin, int64_t nTimeTx, int& nAttempts, bool& fAbort)
+{
+    AssertLockHeld(cs_stakeCandidates);
+
+    // below this many candidates per thread, starting threads costs more than it saves
+    static const size_t MIN_CANDIDATES_PER_THREAD = 1000;
+    // candidates checked between two looks at the tip, the wallet lock and shutdown
+    static const size_t CANDIDATES_PER_CHECK = 256;
+
+    const size_t nEnd = vStakeCandidates.size();
+    const int nHeightTx = pindexPrev->nHeight + 1;
+    const int nThreads = (int)std::max<size_t>(1, std::min<size_t>(nStakingThreads, (nEnd - nBegin) / MIN_CANDIDATES_PER_THREAD));
+    const size_t nChunk = (nEnd - nBegin + nThreads - 1) / nThreads;
+
+    std::atomic<size_t> nFound{nEnd};
+    std::atomic<bool> fAbortSearch{false};
+    std::atomic<int> nTotalAttempts{0};
+    auto search = [&](size_t nFrom, size_t nTo) {
+        int nThreadAttempts = 0;
+        for (size_t i = nFrom; i < nTo; i++) {
+            if (nFound.load(std::memory_order_relaxed) != nEnd || fAbortSearch.load(std::memory_order_relaxed))
+                break;
+            if ((i - nFrom) % CANDIDATES_PER_CHECK == 0 &&
+                    (GetChainHeight() != pindexPrev->nHeight || IsLocked() || ShutdownRequested())) {
+                fAbortSearch = true;
+                break;
+            }
+            nThreadAttempts++;
+            const CStakeCandidate& candidate = vStakeCandidates[i].second;
+            if (candidate.ContextCheck(nHeightTx, nTimeTx) && candidate.CheckKernelHash(nTimeTx)) {
+                size_t nExpected = nEnd;
+                nFound.compare_exchange_strong(nExpected, i);
+                break;
+            }
+        }
+        nTotalAttempts += nThreadAttempts;
+    };
+
+    // the calling thread searches the first chunk
+    std::vector<std::thread> vThreads;
+    for (int t = 1; t < nThreads; t++) {
+        const size_t nFrom = nBegin + t * nChunk;
+        vThreads.emplace_back(search, nFrom, std::min(nEnd, nFrom + nChunk));
+    }
+    search(nBegin, std::min(nEnd, nBegin + nChunk));
+    for (std::thread& thread : vThreads)
+        thread.join();
+
+    nAttempts += nTotalAttempts;
+    fAbort = fAbortSearch;
+    return fAbort ? nEnd : nFound.load();
+}
+
 bool CWallet::CreateCoinStake(
         const CKeyStore& keystore,
         const CBlockIndex* pindexPrev,
@@ -2710,39 +2814,50 @@ bool CWallet::CreateCoinStake(
     bool onlyP2PK = !consensus.NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V5_DUMMY);
 
     // Kernel Search
+    // Get the new time slot (and verify it's not the same as previous block)
+    const bool fRegTest = Params().IsRegTestNet();
+    nTxNewTime = (fRegTest ? GetAdjustedTime() : GetCurrentTimeSlot());
+    pStakerStatus->SetLastTime(nTxNewTime);
+    if (nTxNewTime <= pindexPrev->nTime && !fRegTest) return false;
+
+    // the coins can change at the same tip (spent, locked, new), not necessarily their number
+    CHashWriter ssCoins(SER_GETHASH, 0);
+    for (const COutput& out : *availableCoins)
+        ssCoins << out.tx->GetHash() << out.i;
+    const uint256& hashCoins = ssCoins.GetHash();
+
+    LOCK(cs_stakeCandidates);
+    if (hashStakeCandidatesTip != pindexPrev->GetBlockHash() || nStakeCandidatesBits != nBits ||
+            hashStakeCandidatesCoins != hashCoins) {
+        BuildStakeCandidates(pindexPrev, nBits, *availableCoins);
+        hashStakeCandidatesCoins = hashCoins;
+    }
+
     CAmount nCredit;
-    CScript scriptPubKeyKernel;
     bool fKernelFound = false;
     int nAttempts = 0;
-    for (const COutput &out : *availableCoins) {
-        CRpdStake stakeInput;
-        stakeInput.SetPrevout((CTransaction) *out.tx, out.i);
-
-        //new block came in, move on
-        if (WITH_LOCK(cs_main, return chainActive.Height()) != pindexPrev->nHeight) return false;
+    size_t nNext = 0;
+    while (nNext < vStakeCandidates.size()) {
+        fKernelFound = false;
+        bool fAbort = false;
+        const size_t nFound = SearchStakeKernel(pindexPrev, nNext, nTxNewTime, nAttempts, fAbort);
 
-        // Make sure the wallet is unlocked and shutdown hasn't been requested
-        if (IsLocked() || ShutdownRequested()) return false;
+        // update staker status (attempts)
+        pStakerStatus->SetLastTries(nAttempts);
 
-        // This should never happen
-        if (stakeInput.IsZRPD()) {
-            LogPrintf("%s: ERROR - zPOS is disabled\n", __func__);
-            continue;
-        }
+        // new block came in, wallet locked or shutdown requested
+        if (fAbort) return false;
 
+        fKernelFound = nFound < vStakeCandidates.size();
+        if (!fKernelFound) break;
+        nNext = nFound + 1;
         nCredit = 0;
 
-        nAttempts++;
-        fKernelFound = Stake(pindexPrev, &stakeInput, nBits, nTxNewTime);
-
-        // update staker status (time, attempts)
-        pStakerStatus->SetLastTime(nTxNewTime);
-        pStakerStatus->SetLastTries(nAttempts);
-
-        if (!fKernelFound) continue;
-
         // Found a kernel
         LogPrintf("CreateCoinStake : kernel found\n");
+        const COutput& out = vStakeCandidates[nFound].first;
+        CRpdStake stakeInput;
+        stakeInput.SetPrevout((CTransaction) *out.tx, out.i);
         nCredit += stakeInput.GetValue();
 
         // Add block reward to the credit
@@ -3730,6 +3845,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"), DEFAULT_GENERATE_PROCLIMIT));
     strUsage += HelpMessageOpt("-minstakesplit=<amt>", strprintf(_("Minimum positive amount (in RPD) allowed by GUI and RPC for the stake split threshold (default: %s)"), FormatMoney(DEFAULT_MIN_STAKE_SPLIT_THRESHOLD)));
     strUsage += HelpMessageOpt("-staking=<n>", strprintf(_("Enable staking functionality (0-1, default: %u)"), DEFAULT_STAKING));
+    strUsage += HelpMessageOpt("-stakingthreads=<n>", strprintf(_("Set the number of threads searching stake kernels (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -GetNumCores(), MAX_STAKING_THREADS, DEFAULT_STAKING_THREADS));
     if (showDebug) {
         strUsage += HelpMessageGroup(_("Wallet debugging/testing options:"));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf(_("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)"), DEFAULT_WALLET_DBLOGSIZE));
@@ -77,6 +77,10 @@ static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 static const bool DEFAULT_SEND_FREE_TRANSACTIONS = false;
 //! Default for -staking
 static const bool DEFAULT_STAKING = true;
+//! Default for -stakingthreads
+static const int DEFAULT_STAKING_THREADS = 1;
+//! Maximum number of kernel search threads
+static const int MAX_STAKING_THREADS = 16;
 //! Default for -coldstaking
 static const bool DEFAULT_COLDSTAKING = true;
 //! Defaults for -gen and -genproclimit
@@ -289,6 +293,15 @@ private:
     // Zerocoin wallet
     CzRPDWallet* zwallet{nullptr};
 
+    //! Kernel search table of the staking coins, rebuilt by CreateCoinStake for each tip
+    RecursiveMutex cs_stakeCandidates;
+    std::vector<std::pair<COutput, CStakeCandidate> > vStakeCandidates;
+    uint256 hashStakeCandidatesTip;
+    unsigned int nStakeCandidatesBits{0};
+    uint256 hashStakeCandidatesCoins;
+    void BuildStakeCandidates(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutput>& vCoins);
+    size_t SearchStakeKernel(const CBlockIndex* pindexPrev, size_t nBegin, int64_t nTimeTx, int& nAttempts, bool& fAbort);
+
 public:
 
     static const CAmount DEFAULT_STAKE_SPLIT_THRESHOLD = 500 * COIN;
@@ -333,6 +346,8 @@ public:
     CAmount nStakeSplitThreshold;
     // minimum value allowed for nStakeSplitThreshold (customizable with -minstakesplit flag)
     static CAmount minStakeSplitThreshold;
+    // number of threads searching stake kernels (customizable with -stakingthreads flag)
+    static int nStakingThreads;
     // Staker status (last hashed block and time)
     CStakerStatus* pStakerStatus = nullptr;
 
@@ -520,6 +535,8 @@ public:
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false, bool fromStartup = false);
     void ReacceptWalletTransactions(bool fFirstLoad = false);
     void ResendWalletTransactions(CConnman* connman);
+    /** Wait for the notifications queued so far, so the wallet has seen the current tip */
+    void BlockUntilSyncedToCurrentChain();
 
     CAmount loopTxsBalance(std::function<void(const uint256&, const CWalletTx&, CAmount&)>method) const;
     CAmount GetAvailableBalance(bool fIncludeDelegated = true) const;
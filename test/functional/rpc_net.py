@@ -30,6 +30,7 @@ class NetTest(RpdChainTestFramework):
 
         self._test_connection_count()
         self._test_getnettotals()
+        self._test_getnettrafficstats()
         self._test_getnetworkinginfo()
         self._test_getaddednodeinfo()
         #self._test_getpeerinfo()
@@ -64,6 +65,18 @@ class NetTest(RpdChainTestFramework):
 
         peer_info_after_ping = self.nodes[0].getpeerinfo()
 
+    def _test_getnettrafficstats(self):
+        # the pings above were both sent and answered
+        stats = self.nodes[0].getnettrafficstats()
+        assert_equal(len(stats['peers']), 2)
+        assert_greater_than_or_equal(stats['per_msg']['ping']['msgssent'], 2)
+        assert_greater_than_or_equal(stats['per_msg']['pong']['msgsrecv'], 2)
+        for peer in stats['peers']:
+            assert_equal(peer['totaltime'], peer['processtime'] + peer['sendmessagestime'] + peer['getdatatime'])
+        assert_greater_than_or_equal(stats['peers'][0]['totaltime'], stats['peers'][1]['totaltime'])
+        assert_equal(len(self.nodes[0].getnettrafficstats(1)['peers']), 1)
+        assert_raises_rpc_error(-8, "Invalid count", self.nodes[0].getnettrafficstats, -1)
+
     def _test_getnetworkinginfo(self):
         assert_equal(self.nodes[0].getnetworkinfo()['connections'], 2)
 